@@ -179,12 +179,17 @@ void RenderArea::plotAxes(QPainter &painter)
 
 void RenderArea::plotFigure(QPainter &painter)
 {
+    // Gouraud shaded faces are gathered into the tiles of the screen, the
+    // tiles are rasterized on all cores into an image, and the image goes
+    // on the widget in one piece
+    if (shadingVariant == GOURAND)
+        tiles.begin(size());
     for (const auto& p : qAsConst(figure->polygons)) {
         if (isNormalMethodEnabled && p->normal_world.z() >= 0) continue;
-        QVector<QPoint> proj;
-        for (const auto& v : qAsConst(p->vertices))
-            proj.push_back(v->point_world.toPoint());
         if (shadingVariant == FLAT) {
+            QVector<QPoint> proj;
+            for (const auto& v : qAsConst(p->vertices))
+                proj.push_back(v->point_world.toPoint());
             QBrush faceBrush;
             if (faceVariant == NONE)
                 faceBrush = Qt::BrushStyle::NoBrush;
@@ -202,19 +207,36 @@ void RenderArea::plotFigure(QPainter &painter)
         }
         else { // if (shadingVariant == GOURAND)
             QColor clr = (faceVariant == RANDOM ? p->color : 0x00FFFFFF);
-            plotTriangle(painter, proj[0], proj[1], proj[2],
-                             QColor(clr.red()   * std::min(1.0f, p->vertices[0]->light[0]),
-                                    clr.green() * std::min(1.0f, p->vertices[0]->light[1]),
-                                    clr.blue()  * std::min(1.0f, p->vertices[0]->light[2])),
-                             QColor(clr.red()   * std::min(1.0f, p->vertices[1]->light[0]),
-                                    clr.green() * std::min(1.0f, p->vertices[1]->light[1]),
-                                    clr.blue()  * std::min(1.0f, p->vertices[1]->light[2])),
-                             QColor(clr.red()   * std::min(1.0f, p->vertices[2]->light[0]),
-                                    clr.green() * std::min(1.0f, p->vertices[2]->light[1]),
-                                    clr.blue()  * std::min(1.0f, p->vertices[2]->light[2])));
-            if (isDrawingWireframe) {
-                painter.setPen(Qt::GlobalColor::white);
-                painter.setBrush(Qt::BrushStyle::NoBrush);
+            const QPointF center = getCenter();
+            tiles.addTriangle(p->vertices[0]->point_world.toPointF() + center,
+                              p->vertices[1]->point_world.toPointF() + center,
+                              p->vertices[2]->point_world.toPointF() + center,
+                              QColor(clr.red()   * std::min(1.0f, p->vertices[0]->light[0]),
+                                     clr.green() * std::min(1.0f, p->vertices[0]->light[1]),
+                                     clr.blue()  * std::min(1.0f, p->vertices[0]->light[2])),
+                              QColor(clr.red()   * std::min(1.0f, p->vertices[1]->light[0]),
+                                     clr.green() * std::min(1.0f, p->vertices[1]->light[1]),
+                                     clr.blue()  * std::min(1.0f, p->vertices[1]->light[2])),
+                              QColor(clr.red()   * std::min(1.0f, p->vertices[2]->light[0]),
+                                     clr.green() * std::min(1.0f, p->vertices[2]->light[1]),
+                                     clr.blue()  * std::min(1.0f, p->vertices[2]->light[2])));
+        }
+    }
+    if (shadingVariant == GOURAND) {
+        if (shaded.size() != size())
+            shaded = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+        tiles.render(shaded);
+        painter.drawImage(-getCenter(), shaded);
+        // the wireframe goes over all the faces at once, of the same faces
+        // as were filled
+        if (isDrawingWireframe) {
+            painter.setPen(Qt::GlobalColor::white);
+            painter.setBrush(Qt::BrushStyle::NoBrush);
+            for (const auto& p : qAsConst(figure->polygons)) {
+                if (isNormalMethodEnabled && p->normal_world.z() >= 0) continue;
+                QVector<QPoint> proj;
+                for (const auto& v : qAsConst(p->vertices))
+                    proj.push_back(v->point_world.toPoint());
                 painter.drawPolygon(proj);
             }
         }
@@ -269,59 +291,6 @@ void RenderArea::plotLighter(QPainter &painter)
     painter.drawEllipse(lighter.pos_world.toPointF(), 10, 10);
 }
 
-void RenderArea::plotTriangle(QPainter& painter, QPoint p1, QPoint p2,
-                              QPoint p3, QColor c1, QColor c2, QColor c3)
-{
-    struct PointClr {
-        struct { int x, y; }; QVector3D clr;
-        PointClr(QPoint p, QColor c) : x(p.x()), y(p.y())
-                                     , clr(c.red(), c.green(), c.blue()) { }
-    };
-    std::vector<PointClr> p = { { p1, c1 }, { p2, c2 }, { p3, c3 } };
-    std::sort(p.begin(), p.end(), [](PointClr& lhs, PointClr& rhs) {
-        if (lhs.y != rhs.y)
-            return lhs.y < rhs.y;
-        return lhs.x < rhs.x;
-    });
-    const int y10 = p[1].y - p[0].y;
-    const int y20 = p[2].y - p[0].y;
-    const int y21 = p[2].y - p[1].y;
-    const int x10 = p[1].x - p[0].x;
-    const int x20 = p[2].x - p[0].x;
-    const int x21 = p[2].x - p[1].x;
-    bool toswap = x10 * y20 > y10 * x20;
-    for (int y = p[0].y; y < p[1].y; y++) {
-        int x1 = (y - p[0].y) * x10 / y10 + p[0].x;
-        int x2 = (y - p[0].y) * x20 / y20 + p[0].x;
-        QVector3D clr1 = (p[1].clr * (y - p[0].y) + p[0].clr * (p[1].y - y)) / y10;
-        QVector3D clr2 = (p[2].clr * (y - p[0].y) + p[0].clr * (p[2].y - y)) / y20;
-        if (toswap) {
-            std::swap(x1, x2);
-            std::swap(clr1, clr2);
-        }
-        for (int x = x1; x < x2; x++) {
-            QVector3D clr = (clr1 * (x2 - x) + clr2 * (x - x1)) / (x2 - x1);
-            painter.setPen(QColor(clr[0], clr[1], clr[2]));
-            painter.drawPoint(x, y);
-        }
-    }
-    for (int y = p[1].y; y < p[2].y; y++) {
-        int x1 = (y - p[1].y) * x21 / y21 + p[1].x;
-        int x2 = (y - p[0].y) * x20 / y20 + p[0].x;
-        QVector3D clr1 = (p[2].clr * (y - p[1].y) + p[1].clr * (p[2].y - y)) / y21;
-        QVector3D clr2 = (p[2].clr * (y - p[0].y) + p[0].clr * (p[2].y - y)) / y20;
-        if (toswap) {
-            std::swap(x1, x2);
-            std::swap(clr1, clr2);
-        }
-        for (int x = x1; x < x2; x++) {
-            QVector3D clr = (clr1 * (x2 - x) + clr2 * (x - x1)) / (x2 - x1);
-            painter.setPen(QColor(clr[0], clr[1], clr[2]));
-            painter.drawPoint(x, y);
-        }
-    }
-}
-
 void RenderArea::setShadingVariant(ShadingVariant newShadingVariant)
 {
     shadingVariant = newShadingVariant;
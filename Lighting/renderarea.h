@@ -4,9 +4,11 @@
 #include <QWidget>
 #include <QPaintEvent>
 #include <QPainter>
+#include <QImage>
 #include <QMatrix4x4>
 #include <cmath>
 #include "primitives.h"
+#include "tilerenderer.h"
 
 class RenderArea : public QWidget
 {
@@ -111,8 +113,6 @@ private:
     void plotAxes(QPainter& painter);
     void plotFigure(QPainter& painter);
     void plotLighter(QPainter& painter);
-    void plotTriangle(QPainter& painter, QPoint p1, QPoint p2,
-                      QPoint p3, QColor c1, QColor c2, QColor c3);
 
 private:
     Lighter lighter;
@@ -121,6 +121,8 @@ private:
     QMatrix4x4 rotate;
     QMatrix4x4 shift;
     QPoint prevPos;
+    TileRenderer tiles;
+    QImage shaded;  // Gouraud shaded faces of the frame
     QMatrix4x4 point_WorldTrans;
     QMatrix4x4 vector_WorldTrans;
     QMatrix4x4 point_viewport;
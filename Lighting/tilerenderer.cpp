@@ -0,0 +1,261 @@
+#include "tilerenderer.h"
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector3D>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+const int TileRenderer::TileSize;
+
+void TileRenderer::begin(const QSize& size)
+{
+    this->size = size;
+    columns = (size.width() + TileSize - 1) / TileSize;
+    rows = (size.height() + TileSize - 1) / TileSize;
+    // the storage of the last frame is kept for this one
+    triangles.resize(0);
+    bins.resize(columns * rows);
+    for (auto& bin : bins)
+        bin.resize(0);
+}
+
+// Corners are snapped to 1/16 of a pixel and the edge functions are exact
+// in integers, so that a pixel on an edge two triangles share goes to
+// exactly one of them, whichever tiles they are drawn in.
+void TileRenderer::addTriangle(QPointF p1, QPointF p2, QPointF p3,
+                               QColor c1, QColor c2, QColor c3)
+{
+    struct Corner {
+        qint64 x, y; QRgb clr;
+        Corner(QPointF p, QColor c) : x(qRound64(p.x() * 16)), y(qRound64(p.y() * 16))
+                                    , clr(c.rgb()) { }
+    };
+    Corner v[3] = { { p1, c1 }, { p2, c2 }, { p3, c3 } };
+    const qint64 area = (v[1].x - v[0].x) * (v[2].y - v[0].y)
+                      - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+    if (area == 0)
+        return;
+    if (area < 0)
+        std::swap(v[1], v[2]);
+
+    // the pixels whose centres are in the bounding box, cut to the frame
+    Triangle t;
+    const qint64 left   = std::min({ v[0].x, v[1].x, v[2].x });
+    const qint64 right  = std::max({ v[0].x, v[1].x, v[2].x });
+    const qint64 top    = std::min({ v[0].y, v[1].y, v[2].y });
+    const qint64 bottom = std::max({ v[0].y, v[1].y, v[2].y });
+    t.minX = int(std::max<qint64>(0, (left + 7) >> 4));
+    t.maxX = int(std::min<qint64>(size.width() - 1, (right - 8) >> 4));
+    t.minY = int(std::max<qint64>(0, (top + 7) >> 4));
+    t.maxY = int(std::min<qint64>(size.height() - 1, (bottom - 8) >> 4));
+    if (t.minX > t.maxX || t.minY > t.maxY)
+        return;
+
+    // Edge i runs from corner i to the next one and is positive inside.
+    // Edges that are not top or left ones are lowered by one, so that
+    // pixels exactly on them are left out.
+    for (int i = 0; i < 3; i++) {
+        const Corner& a = v[i];
+        const Corner& b = v[(i + 1) % 3];
+        const qint64 dx = b.x - a.x, dy = b.y - a.y;
+        const bool isTopLeft = dy < 0 || (dy == 0 && dx > 0);
+        t.edge[i] = dx * (t.minY * 16 + 8 - a.y) - dy * (t.minX * 16 + 8 - a.x)
+                  - (isTopLeft ? 0 : 1);
+        t.stepX[i] = -dy * 16;
+        t.stepY[i] = dx * 16;
+    }
+
+    t.x = v[0].x;
+    t.y = v[0].y;
+    for (int i = 0; i < 3; i++)
+        t.clr[i] = v[i].clr;
+
+    // Into the bins of the tiles its box touches, but for those an edge
+    // leaves out altogether: there each edge is negative even at the
+    // corner of the tile where it is greatest
+    const int index = triangles.size();
+    triangles.push_back(t);
+    const bool isSingleTile = t.minX / TileSize == t.maxX / TileSize
+                           && t.minY / TileSize == t.maxY / TileSize;
+    for (int ty = t.minY / TileSize; ty <= t.maxY / TileSize; ty++)
+        for (int tx = t.minX / TileSize; tx <= t.maxX / TileSize; tx++) {
+            bool isOutside = false;
+            if (!isSingleTile) {
+                const int x1 = std::max(t.minX, tx * TileSize);
+                const int x2 = std::min(t.maxX, tx * TileSize + TileSize - 1);
+                const int y1 = std::max(t.minY, ty * TileSize);
+                const int y2 = std::min(t.maxY, ty * TileSize + TileSize - 1);
+                for (int i = 0; i < 3 && !isOutside; i++)
+                    isOutside = t.edge[i] + t.stepX[i] * ((t.stepX[i] > 0 ? x2 : x1) - t.minX)
+                                          + t.stepY[i] * ((t.stepY[i] > 0 ? y2 : y1) - t.minY) < 0;
+            }
+            if (!isOutside)
+                bins[ty * columns + tx].push_back(index);
+        }
+}
+
+void TileRenderer::render(QImage& image, int threads) const
+{
+    Q_ASSERT(image.size() == size && image.format() == QImage::Format_ARGB32_Premultiplied);
+    const int tiles = columns * rows;
+    if (tiles == 0)
+        return;
+    // tiles differ a lot in how many triangles they have, so each thread
+    // takes the next tile left whenever it is done with one
+    const int workers = qBound(1, threads > 0 ? threads : QThread::idealThreadCount(), tiles);
+    uchar* bits = image.bits();
+    const int bytesPerLine = image.bytesPerLine();
+    std::atomic<int> next(0);
+    auto work = [&]() {
+        std::vector<QRgb> pixels(TileSize * TileSize);
+        for (int tile; (tile = next++) < tiles; )
+            renderTile(tile, pixels.data(), bits, bytesPerLine);
+    };
+
+    // The helpers are the threads of Qt's global pool, which stay around
+    // from frame to frame, so that a frame does not pay for starting them.
+    // Each says when it is done, as work() must outlive them.
+    class Helper : public QRunnable
+    {
+    public:
+        Helper(const std::function<void()>& work, QSemaphore& done) : work(work), done(done) { }
+        void run() override { work(); done.release(); }
+    private:
+        std::function<void()> work;
+        QSemaphore& done;
+    };
+    QThreadPool* pool = QThreadPool::globalInstance();
+    if (pool->maxThreadCount() < workers)
+        pool->setMaxThreadCount(workers);
+    QSemaphore done;
+    for (int i = 1; i < workers; i++)
+        pool->start(new Helper(work, done));
+    work();
+    done.acquire(workers - 1);
+}
+
+// Fills the tile's triangles into pixels, TileSize to a row, one after
+// another: each row's span is solved from the edge functions, and colours
+// are stepped along it in 16.16 fixed point. Then the tile goes into the
+// image at bits.
+void TileRenderer::renderTile(int tile, QRgb* pixels, uchar* bits, int bytesPerLine) const
+{
+    const int left = tile % columns * TileSize, top = tile / columns * TileSize;
+    const int width = std::min(TileSize, size.width() - left);
+    const int height = std::min(TileSize, size.height() - top);
+    for (int y = 0; y < height; y++)
+        std::fill_n(pixels + y * TileSize, width, QRgb(0));
+
+    auto channel = [](qint64 c) { return int(qBound<qint64>(0, c >> 16, 255)); };
+    for (int index : bins[tile]) {
+        const Triangle& t = triangles[index];
+        const int minX = std::max(t.minX, left), maxX = std::min(t.maxX, left + width - 1);
+        const int minY = std::max(t.minY, top), maxY = std::min(t.maxY, top + height - 1);
+        if (minX > maxX || minY > maxY)
+            continue;
+
+        // Colour gradients and the colour at the centre of the triangle's
+        // first pixel, in 16.16 fixed point, the same whichever tile works
+        // them out. Slivers can have very steep gradients, hence the 64 bits.
+        const float x10 = t.stepY[0] / 256.f, y10 = -t.stepX[0] / 256.f;
+        const float x20 = -t.stepY[2] / 256.f, y20 = t.stepX[2] / 256.f;
+        const float det = (t.stepY[0] * t.stepX[2] - t.stepX[0] * t.stepY[2]) / 256 / 256.f;
+        const QVector3D clr0(qRed(t.clr[0]), qGreen(t.clr[0]), qBlue(t.clr[0]));
+        const QVector3D clr10 = QVector3D(qRed(t.clr[1]), qGreen(t.clr[1]), qBlue(t.clr[1])) - clr0;
+        const QVector3D clr20 = QVector3D(qRed(t.clr[2]), qGreen(t.clr[2]), qBlue(t.clr[2])) - clr0;
+        const QVector3D dClrX = (clr10 * y20 - clr20 * y10) / det;
+        const QVector3D dClrY = (clr20 * x10 - clr10 * x20) / det;
+        const QVector3D corner = clr0 + dClrX * (t.minX + 0.5f - t.x / 16.f)
+                                      + dClrY * (t.minY + 0.5f - t.y / 16.f);
+        qint64 clrStepX[3], clrStepY[3], clrRow[3];
+        for (int c = 0; c < 3; c++) {
+            clrStepX[c] = qRound64(dClrX[c] * 65536.0);
+            clrStepY[c] = qRound64(dClrY[c] * 65536.0);
+            clrRow[c] = qRound64(corner[c] * 65536.0);
+        }
+
+        // the edges and the colour at the centre of pixel (minX, minY)
+        qint64 edge[3];
+        double reciprocal[3];
+        for (int i = 0; i < 3; i++) {
+            edge[i] = t.edge[i] + t.stepX[i] * (minX - t.minX) + t.stepY[i] * (minY - t.minY);
+            clrRow[i] += clrStepX[i] * (minX - t.minX) + clrStepY[i] * (minY - t.minY);
+            reciprocal[i] = t.stepX[i] ? 1.0 / t.stepX[i] : 0;
+        }
+
+        for (int y = minY; y <= maxY; y++) {
+            // where each edge turns negative is estimated with its
+            // reciprocal step and then made exact
+            qint64 from = 0, to = maxX - minX;
+            for (int i = 0; i < 3 && from <= to; i++) {
+                const qint64 e = edge[i], s = t.stepX[i];
+                if (s > 0) {
+                    if (e < 0) {
+                        qint64 k = qint64(std::ceil(-e * reciprocal[i]));
+                        while (e + s * k < 0)
+                            k++;
+                        while (k > 0 && e + s * (k - 1) >= 0)
+                            k--;
+                        from = std::max(from, k);
+                    }
+                }
+                else if (s < 0) {
+                    if (e < 0)
+                        to = -1;
+                    else {
+                        qint64 k = qint64(-e * reciprocal[i]);
+                        while (e + s * k < 0)
+                            k--;
+                        while (e + s * (k + 1) >= 0)
+                            k++;
+                        to = std::min(to, k);
+                    }
+                }
+                else if (e < 0)
+                    to = -1;
+            }
+            qint64 clr[3];
+            for (int c = 0; c < 3; c++) {
+                clr[c] = clrRow[c] + clrStepX[c] * from;
+                clrRow[c] += clrStepY[c];
+            }
+            for (int i = 0; i < 3; i++)
+                edge[i] += t.stepY[i];
+            if (from > to)
+                continue;
+
+            const int x1 = minX + int(from), x2 = minX + int(to);
+            QRgb* out = pixels + (y - top) * TileSize + (x1 - left);
+            // colours only leave 0..255 by rounding, at the ends of a span
+            bool isInRange = true;
+            for (int c = 0; c < 3; c++) {
+                const qint64 last = clr[c] + clrStepX[c] * (x2 - x1);
+                isInRange &= std::min(clr[c], last) >= 0 && std::max(clr[c], last) < 256 << 16;
+            }
+            qint64 r = clr[0], g = clr[1], b = clr[2];
+            if (isInRange)
+                for (int x = x1; x <= x2; x++) {
+                    *out++ = 0xff000000 | QRgb(r >> 16 << 16 | g >> 16 << 8 | b >> 16);
+                    r += clrStepX[0];
+                    g += clrStepX[1];
+                    b += clrStepX[2];
+                }
+            else
+                for (int x = x1; x <= x2; x++) {
+                    *out++ = qRgb(channel(r), channel(g), channel(b));
+                    r += clrStepX[0];
+                    g += clrStepX[1];
+                    b += clrStepX[2];
+                }
+        }
+    }
+
+    for (int y = 0; y < height; y++)
+        std::memcpy(reinterpret_cast<QRgb*>(bits + size_t(top + y) * bytesPerLine) + left,
+                    pixels + y * TileSize, width * sizeof(QRgb));
+}
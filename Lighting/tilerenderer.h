@@ -0,0 +1,60 @@
+#ifndef TILERENDERER_H
+#define TILERENDERER_H
+
+#include <QColor>
+#include <QImage>
+#include <QPointF>
+#include <QSize>
+#include <QVector>
+
+// Gouraud shaded triangles of a frame, sorted into the square tiles of
+// the screen they touch and then rasterized a tile at a time, on as many
+// threads of Qt's global pool as asked for. Each tile keeps its triangles
+// in the order they were added, so later ones cover earlier ones just as
+// if they were drawn one by one, and is filled in a buffer of its own
+// before it is copied into the image.
+class TileRenderer
+{
+public:
+    static const int TileSize = 64;
+
+    // starts a frame of the given size in pixels
+    void begin(const QSize& size);
+
+    // Corners are in pixels. Pixels whose centres are inside the triangle
+    // are filled, and of two triangles sharing an edge, a pixel on it goes
+    // to the one for which it is a top or a left edge.
+    void addTriangle(QPointF p1, QPointF p2, QPointF p3,
+                     QColor c1, QColor c2, QColor c3);
+
+    // Fills image, of the frame's size, with the triangles over a
+    // transparent background, on all cores when threads is 0
+    void render(QImage& image, int threads = 0) const;
+
+    int triangleCount() const { return triangles.size(); }
+
+private:
+    // What filling a triangle needs, set up once for all its tiles: the
+    // pixels whose centres are in its bounding box; the edge functions at
+    // the centre of the box's first pixel and their steps to the next
+    // pixel along and down; its first corner, in 1/16 of a pixel, and the
+    // colours at its corners. The colours across it are worked out by
+    // the tiles, so that it is on all threads.
+    struct Triangle
+    {
+        int minX, maxX, minY, maxY;
+        qint64 edge[3], stepX[3], stepY[3];
+        qint64 x, y;
+        QRgb clr[3];
+    };
+
+    void renderTile(int tile, QRgb* pixels, uchar* bits, int bytesPerLine) const;
+
+    QSize size;
+    int columns = 0;
+    int rows = 0;
+    QVector<Triangle> triangles;
+    QVector<QVector<int> > bins;    // the triangles of each tile, in order
+};
+
+#endif // TILERENDERER_H
@@ -0,0 +1,126 @@
+#include <QCoreApplication>
+#include <QPair>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include "../Lighting/primitives.h"
+#include "../Lighting/tilerenderer.h"
+
+// Draws a finely tessellated cone at 4K, Gouraud shaded as RenderArea
+// draws it, and reports how rasterizing its tiles scales with the number
+// of threads, from one up to the number of cores:
+//
+//     LightingBench [segments around] [frames]
+//
+// Gathering the triangles into tiles is timed on its own, since it runs
+// on one thread whatever the count.
+
+// Lights the cone with a white light from the front, as paintEvent does
+// with the figure's, and sorts its faces farthest first
+static void light(ConeMesh& cone, const QMatrix4x4& m)
+{
+    const QMatrix4x4 normals = m.inverted().transposed();
+    const QVector3D light = QVector3D(-1, -1, -2).normalized();
+    for (auto& p : cone.polygons)
+        p->normal_world = normals * p->normal_local;
+    for (auto& v : cone.vertices) {
+        v->point_world = m * v->point_local;
+        v->normal_world = normals * v->normal_local;
+        const float diffuse = QVector3D::dotProduct(
+                    v->normal_world.toVector3D().normalized(), -light);
+        v->light = QVector3D(1, 1, 1) * (0.2f + 0.8f * std::max(0.0f, diffuse));
+    }
+    QVector<QPair<float, std::shared_ptr<Polygon> > > depths;
+    for (const auto& p : qAsConst(cone.polygons))
+        depths.push_back({ p->mid().point_world.z(), p });
+    std::stable_sort(depths.begin(), depths.end(),
+                     [](const QPair<float, std::shared_ptr<Polygon> >& lhs,
+                        const QPair<float, std::shared_ptr<Polygon> >& rhs) {
+        return lhs.first > rhs.first;
+    });
+    for (int i = 0; i < depths.size(); i++)
+        cone.polygons[i] = depths[i].second;
+}
+
+// The front faces into tiles, as plotFigure hands them over
+static void gather(const ConeMesh& cone, const QSize& size, TileRenderer& tiles)
+{
+    const QPointF center(size.width() / 2, size.height() / 2);
+    tiles.begin(size);
+    for (const auto& p : qAsConst(cone.polygons)) {
+        if (p->normal_world.z() >= 0) continue;
+        QPointF corners[3];
+        QColor colors[3];
+        for (int k = 0; k < 3; k++) {
+            corners[k] = p->vertices[k]->point_world.toPointF() + center;
+            const QVector3D light = p->vertices[k]->light;
+            colors[k] = QColor(p->color.red()   * std::min(1.0f, light[0]),
+                               p->color.green() * std::min(1.0f, light[1]),
+                               p->color.blue()  * std::min(1.0f, light[2]));
+        }
+        tiles.addTriangle(corners[0], corners[1], corners[2],
+                          colors[0], colors[1], colors[2]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    const int segments = argc > 1 ? QString(argv[1]).toInt() : 1000;
+    const int frames = argc > 2 ? QString(argv[2]).toInt() : 8;
+    const QSize size(3840, 2160);
+    QTextStream out(stdout);
+
+    ConeMesh cone(1, 1, 2, 0.5, segments, segments / 2, segments / 4);
+    for (auto& v : cone.vertices)
+        v->create_normal();
+    out << "cone: " << cone.polygons.size() << " triangles at "
+        << size.width() << 'x' << size.height() << ", " << frames << " frames" << '\n';
+
+    // every frame is gathered once and then rasterized with each count
+    QVector<TileRenderer> scenes(frames);
+    QElapsedTimer timer;
+    qint64 gatherNs = 0;
+    for (int f = 0; f < frames; f++) {
+        QMatrix4x4 m;
+        m.scale(0.35f * size.height());
+        m.rotate(20, 1, 0, 0);
+        m.rotate(360.0f * f / frames, 0, 1, 0);
+        light(cone, m);
+        timer.start();
+        gather(cone, size, scenes[f]);
+        gatherNs += timer.nsecsElapsed();
+    }
+    out << "  gather and bin: " << gatherNs / 1e6 / frames << " ms per frame, "
+        << scenes.first().triangleCount() << " triangles drawn" << '\n';
+
+    QVector<int> counts;
+    const int cores = QThread::idealThreadCount();
+    for (int threads = 1; threads < cores; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(cores);
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    double single = 0;
+    for (int threads : qAsConst(counts)) {
+        // the fastest of a few rounds, as other work on the machine only
+        // ever makes a round slower
+        qint64 best = -1;
+        for (int round = 0; round < 3; round++) {
+            timer.start();
+            for (const TileRenderer& scene : qAsConst(scenes))
+                scene.render(image, threads);
+            const qint64 ns = timer.nsecsElapsed();
+            best = best < 0 ? ns : std::min(best, ns);
+        }
+        const double ms = best / 1e6 / frames;
+        if (threads == 1)
+            single = ms;
+        out << "  " << threads << (threads == 1 ? " thread: " : " threads: ") << ms
+            << " ms per frame, " << single / ms << " times as fast, "
+            << qRound(100 * single / ms / threads) << "% efficiency" << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "clipping.h"
+
+namespace {
+
+// signed distance of p from the guard band plane, positive inside
+float distance(const QVector4D& p, int plane, const Frustum& f)
+{
+    const QRectF& r = f.guardBand;
+    switch (plane) {
+    case ClipLeft:   return p.x() - float(r.left())   * p.w();
+    case ClipRight:  return float(r.right())  * p.w() - p.x();
+    case ClipTop:    return p.y() - float(r.top())    * p.w();
+    case ClipBottom: return float(r.bottom()) * p.w() - p.y();
+    default:         return p.w() - f.nearW;
+    }
+}
+
+// near first, so that no later plane sees a point behind the eye
+const int planes[] = { ClipNear, ClipLeft, ClipRight, ClipTop, ClipBottom };
+
+} // namespace
+
+void clipPolygon(const QVector<QVector4D>& polygon, const Frustum& frustum,
+                 QPolygonF& out)
+{
+    out.resize(0);
+    int codes = 0;
+    for (const QVector4D& p : polygon)
+        codes |= frustum.outcode(p) >> GuardShift;
+
+    QVector<QVector4D> in = polygon, next;
+    for (int plane : planes) {
+        if (!(codes & plane))
+            continue;
+        next.resize(0);
+        for (int j = 0, k = in.size() - 1; j < in.size(); k = j++) {
+            float dk = distance(in[k], plane, frustum);
+            float dj = distance(in[j], plane, frustum);
+            if ((dk >= 0) != (dj >= 0))
+                next.push_back(in[k] + (in[j] - in[k]) * (dk / (dk - dj)));
+            if (dj >= 0)
+                next.push_back(in[j]);
+        }
+        if (next.size() < 3)
+            return;
+        std::swap(in, next);
+    }
+    for (const QVector4D& p : qAsConst(in))
+        out.push_back(project(p));
+}
+
+bool clipLine(QVector4D& a, QVector4D& b, const Frustum& frustum)
+{
+    float t0 = 0, t1 = 1;
+    for (int plane : planes) {
+        float da = distance(a, plane, frustum), db = distance(b, plane, frustum);
+        if (da < 0 && db < 0)
+            return false;
+        if (da < 0)
+            t0 = qMax(t0, da / (da - db));
+        else if (db < 0)
+            t1 = qMin(t1, da / (da - db));
+    }
+    if (t0 > t1)
+        return false;
+    const QVector4D from = a, d = b - a;
+    a = from + d * t0;
+    b = from + d * t1;
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef CLIPPING_H
+#define CLIPPING_H
+
+#include <QPolygonF>
+#include <QRectF>
+#include <QVector4D>
+
+// Outcode bits; the guard band planes repeat them shifted by GuardShift
+enum ClipPlane {
+    ClipLeft   = 0x1,
+    ClipRight  = 0x2,
+    ClipTop    = 0x4,
+    ClipBottom = 0x8,
+    ClipNear   = 0x10,
+    ClipAll    = 0x1f,
+    GuardShift = 5,
+};
+
+// View volume in homogeneous coordinates (x, y, z, w): x, y, z are the
+// transformed points and w = 1 + z / eyeDistance puts the eye at
+// z = -eyeDistance, so that x / w, y / w are pixels from the widget centre.
+// Without an eye distance w is 1 and the view is orthographic.
+struct Frustum
+{
+    float eyeDistance = 0;
+    float nearW = 0.01f;   // nothing closer to the eye than this is drawn
+    QRectF viewport;       // what the widget shows
+    QRectF guardBand;      // how far faces may reach before they are cut
+
+    bool isPerspective() const { return eyeDistance > 0; }
+
+    float w(float z) const { return isPerspective() ? 1 + z / eyeDistance : 1; }
+
+    QVector4D toClip(float x, float y, float z) const { return { x, y, z, w(z) }; }
+
+    // the planes p is outside of, both of the viewport and of the guard band
+    int outcode(const QVector4D& p) const;
+};
+
+inline int Frustum::outcode(const QVector4D& p) const
+{
+    auto code = [&](const QRectF& r) {
+        return (p.x() < r.left()   * p.w() ? ClipLeft   : 0)
+             | (p.x() > r.right()  * p.w() ? ClipRight  : 0)
+             | (p.y() < r.top()    * p.w() ? ClipTop    : 0)
+             | (p.y() > r.bottom() * p.w() ? ClipBottom : 0)
+             | (p.w() < nearW              ? ClipNear   : 0);
+    };
+    return code(viewport) | code(guardBand) << GuardShift;
+}
+
+inline QPointF project(const QVector4D& p)
+{
+    return { p.x() / p.w(), p.y() / p.w() };
+}
+
+// Sutherland-Hodgman clipping of the polygon against the guard band and
+// the near plane; out gets what is left in pixels, empty if nothing is
+void clipPolygon(const QVector<QVector4D>& polygon, const Frustum& frustum,
+                 QPolygonF& out);
+
+// Cuts the segment ab to the guard band and the near plane; false if
+// nothing is left
+bool clipLine(QVector4D& a, QVector4D& b, const Frustum& frustum);
+
+#endif // CLIPPING_H
@@ -0,0 +1,524 @@
+#include "polyhedron.h"
+#include <cmath>
+
+// Every generator sizes its arrays up front and fills them from several
+// threads at once, each writing only the vertices and polygons it owns.
+
+namespace {
+
+// Raw access to coordinates for the parallel writers
+struct CoordsWriter
+{
+    float *x, *y, *z;
+    explicit CoordsWriter(Coords& c) : x(c.x.data()), y(c.y.data()), z(c.z.data()) {}
+    void set(int i, const QVector3D& p) { x[i] = p.x(); y[i] = p.y(); z[i] = p.z(); }
+};
+
+// offsets of polygons that all have the same number of corners
+void setUniformOffsets(Polyhedron& mesh, int polygons, int corners)
+{
+    mesh.offsets.resize(polygons + 1);
+    int* offsets = mesh.offsets.data();
+    parallelFor(polygons + 1, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            offsets[i] = i * corners;
+    });
+}
+
+// same size and normals as the basic figures
+void finish(Polyhedron& mesh)
+{
+    const float L = 50;
+    mesh.fitTo(L);
+    mesh.buildNormals(L * 0.3);
+    mesh.randomizeColors();
+    mesh.buildAdjacency();
+}
+
+// Signed power used by the superquadric surface
+float spow(float base, float exponent)
+{
+    return std::copysign(std::pow(std::abs(base), exponent), base);
+}
+
+// the corners next to v in all polygons around it, sorted, with repeats;
+// an edge bordering a single polygon shows up once
+void collectRing(const Polyhedron& mesh, int v, QVector<int>& ring)
+{
+    ring.resize(0);
+    for (int k = mesh.vertexOffsets[v]; k < mesh.vertexOffsets[v + 1]; k++) {
+        int p = mesh.vertexPolygons[k];
+        const int* vs = mesh.polygon(p);
+        int n = mesh.polygonSize(p), j = 0;
+        while (vs[j] != v) j++;
+        ring.push_back(vs[(j + 1) % n]);
+        ring.push_back(vs[(j + n - 1) % n]);
+    }
+    std::sort(ring.begin(), ring.end());
+}
+
+// Numbered edges of a mesh with half-edges built, in the order of their
+// first half-edges
+struct EdgeTable
+{
+    QVector<int> starts;      // edge e runs from starts[e] to ends[e]
+    QVector<int> ends;
+    QVector<int> sides;       // two per edge: the polygon running from start
+                              // to end along it, then the other one, or -1
+    QVector<int> cornerEdges; // edge from every corner to the next one
+
+    explicit EdgeTable(const Polyhedron& mesh);
+    int size() const { return ends.size(); }
+};
+
+EdgeTable::EdgeTable(const Polyhedron& mesh)
+{
+    const int F = mesh.polygonCount();
+    const int chunks = threadCount() * 4;
+    const int* twins = mesh.twins.constData();
+    const int* offsets = mesh.offsets.constData();
+    auto isFirst = [&](int h) { return twins[h] < 0 || h < twins[h]; };
+    auto from = [&](int c) { return offsets[qint64(F) * c / chunks]; };
+
+    QVector<int> first(chunks + 1, 0);
+    int* count = first.data() + 1;
+    parallelFor(chunks, [&](int begin, int end) {
+        for (int c = begin; c < end; c++)
+            for (int h = from(c); h < from(c + 1); h++)
+                count[c] += isFirst(h);
+    }, 1);
+    std::partial_sum(first.begin(), first.end(), first.begin());
+
+    // the twin of a first half-edge comes later and is given its edge
+    // here too
+    starts.resize(first.last());
+    ends.resize(first.last());
+    sides.resize(2 * first.last());
+    cornerEdges.resize(mesh.indices.size());
+    int *s = starts.data(), *e = ends.data(), *side = sides.data();
+    int* corner = cornerEdges.data();
+    parallelFor(chunks, [&](int begin, int end) {
+        for (int c = begin; c < end; c++) {
+            int edge = first[c];
+            for (int p = int(qint64(F) * c / chunks); p < int(qint64(F) * (c + 1) / chunks); p++)
+                for (int h = offsets[p], k = offsets[p + 1] - 1; h < offsets[p + 1]; k = h++) {
+                    if (!isFirst(k))
+                        continue;
+                    s[edge] = mesh.indices[k];
+                    e[edge] = mesh.indices[h];
+                    side[2 * edge] = p;
+                    side[2 * edge + 1] = twins[k] < 0 ? -1 : mesh.halfEdgePolygons[twins[k]];
+                    corner[k] = edge;
+                    if (twins[k] >= 0)
+                        corner[twins[k]] = edge;
+                    edge++;
+                }
+        }
+    }, 1);
+}
+
+// Unique neighbours of a vertex and the ones along the boundary
+struct Ring
+{
+    QVector<int> all, neighbours, boundary;
+
+    void collect(const Polyhedron& mesh, int v)
+    {
+        collectRing(mesh, v, all);
+        neighbours.resize(0);
+        boundary.resize(0);
+        for (int k = 0; k < all.size(); k++) {
+            if (k > 0 && all[k - 1] == all[k])
+                continue;
+            neighbours.push_back(all[k]);
+            if (k + 1 == all.size() || all[k + 1] != all[k])
+                boundary.push_back(all[k]);
+        }
+    }
+};
+
+// One Catmull-Clark step: a quad for every corner, built from the vertex,
+// the points of its two edges and the point of its polygon
+Polyhedron catmullClark(const Polyhedron& mesh)
+{
+    const EdgeTable edges(mesh);
+    const int V = mesh.vertexCount(), E = edges.size(), F = mesh.polygonCount();
+    const int C = mesh.indices.size();
+    Polyhedron out;
+    out.points.resize(V + E + F);
+    out.indices.resize(4 * C);
+    out.colors.resize(C);
+    setUniformOffsets(out, C, 4);
+    CoordsWriter points(out.points);
+    const Coords& written = out.points;
+
+    parallelFor(F, [&](int begin, int end) {
+        for (int f = begin; f < end; f++)
+            points.set(V + E + f, mesh.mid(f, mesh.points));
+    });
+    parallelFor(E, [&](int begin, int end) {
+        for (int e = begin; e < end; e++) {
+            QVector3D p = mesh.points[edges.starts[e]] + mesh.points[edges.ends[e]];
+            int f0 = edges.sides[2 * e], f1 = edges.sides[2 * e + 1];
+            if (f0 >= 0 && f1 >= 0)
+                p = (p + written[V + E + f0] + written[V + E + f1]) / 4;
+            else
+                p /= 2;
+            points.set(V + e, p);
+        }
+    });
+    parallelFor(V, [&](int begin, int end) {
+        Ring ring;
+        for (int v = begin; v < end; v++) {
+            ring.collect(mesh, v);
+            QVector3D p = mesh.points[v];
+            if (ring.boundary.size() == 2) {
+                p = (6 * p + mesh.points[ring.boundary[0]]
+                           + mesh.points[ring.boundary[1]]) / 8;
+            }
+            else if (ring.boundary.isEmpty() && !ring.neighbours.isEmpty()) {
+                int n = mesh.vertexOffsets[v + 1] - mesh.vertexOffsets[v];
+                QVector3D q, r;
+                for (int k = mesh.vertexOffsets[v]; k < mesh.vertexOffsets[v + 1]; k++)
+                    q += written[V + E + mesh.vertexPolygons[k]];
+                for (int u : qAsConst(ring.neighbours))
+                    r += mesh.points[u];
+                q /= n;
+                r = (p + r / ring.neighbours.size()) / 2;
+                p = (q + 2 * r + (n - 3) * p) / n;
+            }
+            points.set(v, p);
+        }
+    });
+
+    int* indices = out.indices.data();
+    QRgb* colors = out.colors.data();
+    parallelFor(F, [&](int begin, int end) {
+        for (int f = begin; f < end; f++) {
+            const int* vs = mesh.polygon(f);
+            const int n = mesh.polygonSize(f), o = mesh.offsets[f];
+            for (int j = 0; j < n; j++) {
+                int* quad = indices + 4 * (o + j);
+                quad[0] = vs[j];
+                quad[1] = V + edges.cornerEdges[o + j];
+                quad[2] = V + E + f;
+                quad[3] = V + edges.cornerEdges[o + (j + n - 1) % n];
+                colors[o + j] = mesh.colors.value(f);
+            }
+        }
+    });
+    out.buildAdjacency();
+    return out;
+}
+
+// Fan triangulation, so that Loop subdivision can take any polygons
+Polyhedron triangulated(const Polyhedron& mesh)
+{
+    Polyhedron out;
+    out.points = mesh.points;
+    const int F = mesh.polygonCount();
+    QVector<int> firstTriangle(F + 1, 0);
+    for (int f = 0; f < F; f++)
+        firstTriangle[f + 1] = firstTriangle[f] + mesh.polygonSize(f) - 2;
+    const int T = firstTriangle.last();
+    out.indices.resize(3 * T);
+    out.colors.resize(T);
+    setUniformOffsets(out, T, 3);
+    int* indices = out.indices.data();
+    QRgb* colors = out.colors.data();
+    parallelFor(F, [&](int begin, int end) {
+        for (int f = begin; f < end; f++) {
+            const int* vs = mesh.polygon(f);
+            for (int j = 2, t = firstTriangle[f]; j < mesh.polygonSize(f); j++, t++) {
+                indices[3 * t] = vs[0];
+                indices[3 * t + 1] = vs[j - 1];
+                indices[3 * t + 2] = vs[j];
+                colors[t] = mesh.colors.value(f);
+            }
+        }
+    });
+    out.buildAdjacency();
+    return out;
+}
+
+// One Loop step over a triangle mesh: every triangle is cut into four
+// through the points of its edges
+Polyhedron loop(const Polyhedron& mesh)
+{
+    const EdgeTable edges(mesh);
+    const int V = mesh.vertexCount(), E = edges.size(), F = mesh.polygonCount();
+    Polyhedron out;
+    out.points.resize(V + E);
+    out.indices.resize(12 * F);
+    out.colors.resize(4 * F);
+    setUniformOffsets(out, 4 * F, 3);
+    CoordsWriter points(out.points);
+
+    // corner of triangle f that is not on edge e
+    auto opposite = [&](int f, int e) {
+        const int* vs = mesh.polygon(f);
+        for (int j = 0; j < 3; j++)
+            if (vs[j] != edges.starts[e] && vs[j] != edges.ends[e])
+                return vs[j];
+        return vs[0];
+    };
+    parallelFor(E, [&](int begin, int end) {
+        for (int e = begin; e < end; e++) {
+            QVector3D p = mesh.points[edges.starts[e]] + mesh.points[edges.ends[e]];
+            int f0 = edges.sides[2 * e], f1 = edges.sides[2 * e + 1];
+            if (f0 >= 0 && f1 >= 0)
+                p = p * 3 / 8 + (mesh.points[opposite(f0, e)]
+                               + mesh.points[opposite(f1, e)]) / 8;
+            else
+                p /= 2;
+            points.set(V + e, p);
+        }
+    });
+    parallelFor(V, [&](int begin, int end) {
+        Ring ring;
+        for (int v = begin; v < end; v++) {
+            ring.collect(mesh, v);
+            QVector3D p = mesh.points[v];
+            if (ring.boundary.size() == 2) {
+                p = p * 3 / 4 + (mesh.points[ring.boundary[0]]
+                               + mesh.points[ring.boundary[1]]) / 8;
+            }
+            else if (ring.boundary.isEmpty() && !ring.neighbours.isEmpty()) {
+                const int n = ring.neighbours.size();
+                const float beta = n == 3 ? 3.f / 16 : 3.f / (8 * n);
+                QVector3D sum;
+                for (int u : qAsConst(ring.neighbours))
+                    sum += mesh.points[u];
+                p = (1 - n * beta) * p + beta * sum;
+            }
+            points.set(v, p);
+        }
+    });
+
+    int* indices = out.indices.data();
+    QRgb* colors = out.colors.data();
+    parallelFor(F, [&](int begin, int end) {
+        for (int f = begin; f < end; f++) {
+            const int* vs = mesh.polygon(f);
+            const int* e = edges.cornerEdges.constData() + 3 * f;
+            const int a = vs[0], b = vs[1], c = vs[2];
+            const int ab = V + e[0], bc = V + e[1], ca = V + e[2];
+            const int children[4][3] = {
+                { a, ab, ca }, { ab, b, bc }, { ca, bc, c }, { ab, bc, ca }
+            };
+            for (int k = 0; k < 4; k++) {
+                for (int j = 0; j < 3; j++)
+                    indices[12 * f + 3 * k + j] = children[k][j];
+                colors[4 * f + k] = mesh.colors.value(f);
+            }
+        }
+    });
+    out.buildAdjacency();
+    return out;
+}
+
+} // namespace
+
+// Icosahedron with every face cut into a 2^level grid of triangles, pushed
+// out onto the sphere. Corners come first, then the points inside the 30
+// edges and then those inside the 20 faces, so that every shared point is
+// written once.
+Polyhedron Polyhedron::GenerateGeodesicSphere(int level)
+{
+    const float t = (1 + std::sqrt(5.f)) / 2;
+    const QVector3D corners[12] = {
+        { -1,  t,  0 }, {  1,  t,  0 }, { -1, -t,  0 }, {  1, -t,  0 },
+        {  0, -1,  t }, {  0,  1,  t }, {  0, -1, -t }, {  0,  1, -t },
+        {  t,  0, -1 }, {  t,  0,  1 }, { -t,  0, -1 }, { -t,  0,  1 },
+    };
+    const int faces[20][3] = {
+        { 0, 11,  5 }, { 0,  5,  1 }, { 0,  1,  7 }, { 0,  7, 10 }, { 0, 10, 11 },
+        { 1,  5,  9 }, { 5, 11,  4 }, { 11, 10, 2 }, { 10, 7,  6 }, { 7,  1,  8 },
+        { 3,  9,  4 }, { 3,  4,  2 }, { 3,  2,  6 }, { 3,  6,  8 }, { 3,  8,  9 },
+        { 4,  9,  5 }, { 2,  4, 11 }, { 6,  2, 10 }, { 8,  6,  7 }, { 9,  8,  1 },
+    };
+    int edgeEnds[30][2], faceEdges[20][3], edgeCount = 0;
+    for (int f = 0; f < 20; f++)
+        for (int j = 0; j < 3; j++) {
+            int a = qMin(faces[f][j], faces[f][(j + 1) % 3]);
+            int b = qMax(faces[f][j], faces[f][(j + 1) % 3]);
+            int e = 0;
+            while (e < edgeCount && (edgeEnds[e][0] != a || edgeEnds[e][1] != b))
+                e++;
+            if (e == edgeCount) {
+                edgeEnds[e][0] = a;
+                edgeEnds[e][1] = b;
+                edgeCount++;
+            }
+            faceEdges[f][j] = e;
+        }
+
+    const int n = 1 << level;
+    const int perEdge = n - 1, perFace = (n - 1) * (n - 2) / 2;
+    const int firstInner = 12 + 30 * perEdge;
+    Polyhedron sphere;
+    sphere.points.resize(firstInner + 20 * perFace);
+    sphere.indices.resize(20 * n * n * 3);
+    setUniformOffsets(sphere, 20 * n * n, 3);
+    CoordsWriter points(sphere.points);
+
+    for (int i = 0; i < 12; i++)
+        points.set(i, corners[i].normalized());
+    // edge points are numbered from the lower corner
+    parallelFor(30 * perEdge, [&](int begin, int end) {
+        for (int k = begin; k < end; k++) {
+            int e = k / perEdge, step = k % perEdge + 1;
+            QVector3D a = corners[edgeEnds[e][0]], b = corners[edgeEnds[e][1]];
+            points.set(12 + k, (a + (b - a) * step / n).normalized());
+        }
+    });
+    int* indices = sphere.indices.data();
+    parallelFor(20, [&](int begin, int end) {
+        for (int f = begin; f < end; f++) {
+            const int A = faces[f][0], B = faces[f][1], C = faces[f][2];
+            const QVector3D a = corners[A], ab = corners[B] - a, ac = corners[C] - a;
+            const int inner = firstInner + f * perFace;
+            auto edgePoint = [&](int from, int to, int edge, int step) {
+                return 12 + faceEdges[f][edge] * perEdge
+                          + (from < to ? step : n - step) - 1;
+            };
+            // grid point i steps along AB and j along AC
+            auto index = [&](int i, int j) {
+                if (j == 0)
+                    return i == 0 ? A : i == n ? B : edgePoint(A, B, 0, i);
+                if (i == 0)
+                    return j == n ? C : edgePoint(C, A, 2, n - j);
+                if (i + j == n)
+                    return edgePoint(B, C, 1, j);
+                return inner + (i - 1) * (n - 1) - (i - 1) * i / 2 + j - 1;
+            };
+            for (int i = 1; i + 2 <= n; i++)
+                for (int j = 1; i + j < n; j++)
+                    points.set(index(i, j), (a + ab * i / n + ac * j / n).normalized());
+            int* tri = indices + 3 * f * n * n;
+            for (int i = 0; i < n; i++)
+                for (int j = 0; i + j < n; j++) {
+                    *tri++ = index(i, j);
+                    *tri++ = index(i + 1, j);
+                    *tri++ = index(i, j + 1);
+                    if (i + j + 1 < n) {
+                        *tri++ = index(i + 1, j);
+                        *tri++ = index(i + 1, j + 1);
+                        *tri++ = index(i, j + 1);
+                    }
+                }
+        }
+    }, 1);
+    finish(sphere);
+    return sphere;
+}
+
+// Ring torus of 8 << level by 4 << level quads
+Polyhedron Polyhedron::GenerateTorus(int level)
+{
+    const int U = 8 << level, V = 4 << level;
+    const float R = 1, r = 0.4f;
+    Polyhedron torus;
+    torus.points.resize(U * V);
+    torus.indices.resize(4 * U * V);
+    setUniformOffsets(torus, U * V, 4);
+    CoordsWriter points(torus.points);
+    int* indices = torus.indices.data();
+    parallelFor(U * V, [&](int begin, int end) {
+        for (int k = begin; k < end; k++) {
+            int u = k / V, v = k % V;
+            float theta = 2 * M_PI * u / U, phi = 2 * M_PI * v / V;
+            float d = R + r * std::cos(phi);
+            points.set(k, QVector3D(d * std::cos(theta), r * std::sin(phi),
+                                    d * std::sin(theta)));
+            int un = (u + 1) % U, vn = (v + 1) % V;
+            int* quad = indices + 4 * k;
+            quad[0] = u * V + v;
+            quad[1] = u * V + vn;
+            quad[2] = un * V + vn;
+            quad[3] = un * V + v;
+        }
+    });
+    finish(torus);
+    return torus;
+}
+
+// Superellipsoid with latitude exponent e1 and longitude exponent e2 on 8
+// << level meridians and 4 << level bands; the polar bands are fans of
+// triangles
+Polyhedron Polyhedron::GenerateSuperquadric(int level, float e1, float e2)
+{
+    const int U = 8 << level, V = 4 << level;
+    const int rings = V - 1, quads = (V - 2) * U;
+    const int top = 0, bottom = 1 + rings * U;
+    Polyhedron shape;
+    shape.points.resize(2 + rings * U);
+    shape.indices.resize(3 * 2 * U + 4 * quads);
+    shape.offsets.resize(U * V + 1);
+    CoordsWriter points(shape.points);
+    int* offsets = shape.offsets.data();
+    int* indices = shape.indices.data();
+
+    points.set(top, QVector3D(0, 1, 0));
+    points.set(bottom, QVector3D(0, -1, 0));
+    parallelFor(rings * U, [&](int begin, int end) {
+        for (int k = begin; k < end; k++) {
+            float eta = M_PI / 2 - M_PI * (k / U + 1) / V;
+            float omega = 2 * M_PI * (k % U) / U;
+            float c = spow(std::cos(eta), e1);
+            points.set(1 + k, QVector3D(c * spow(std::cos(omega), e2),
+                                        spow(std::sin(eta), e1),
+                                        c * spow(std::sin(omega), e2)));
+        }
+    });
+    // ring b, meridian u
+    auto at = [&](int b, int u) { return 1 + b * U + u % U; };
+    parallelFor(U * V, [&](int begin, int end) {
+        for (int p = begin; p < end; p++) {
+            int band = p / U, u = p % U;
+            int o = band == 0 ? 3 * p : 3 * U + 4 * (p - U);
+            if (band == V - 1)
+                o = 3 * U + 4 * quads + 3 * (p - U - quads);
+            offsets[p] = o;
+            int* vs = indices + o;
+            if (band == 0) {
+                vs[0] = top; vs[1] = at(0, u + 1); vs[2] = at(0, u);
+            }
+            else if (band == V - 1) {
+                vs[0] = bottom; vs[1] = at(rings - 1, u); vs[2] = at(rings - 1, u + 1);
+            }
+            else {
+                vs[0] = at(band - 1, u);     vs[1] = at(band - 1, u + 1);
+                vs[2] = at(band, u + 1);     vs[3] = at(band, u);
+            }
+        }
+    });
+    offsets[U * V] = shape.indices.size();
+    finish(shape);
+    return shape;
+}
+
+Polyhedron Polyhedron::subdividedCatmullClark(int levels) const
+{
+    Polyhedron mesh = *this;
+    if (mesh.vertexOffsets.size() != mesh.vertexCount() + 1)
+        mesh.buildAdjacency();
+    for (int i = 0; i < levels; i++) {
+        if (mesh.twins.size() != mesh.indices.size())
+            mesh.buildHalfEdges();
+        mesh = catmullClark(mesh);
+    }
+    mesh.buildNormals(normals.size() ? normals[0].length() : 1);
+    return mesh;
+}
+
+Polyhedron Polyhedron::subdividedLoop(int levels) const
+{
+    Polyhedron mesh = triangulated(*this);
+    for (int i = 0; i < levels; i++) {
+        mesh.buildHalfEdges();
+        mesh = loop(mesh);
+    }
+    mesh.buildNormals(normals.size() ? normals[0].length() : 1);
+    return mesh;
+}
@@ -0,0 +1,176 @@
+#include "hiddenline.h"
+#include <cmath>
+
+namespace {
+
+struct Point
+{
+    float x, y, z;
+};
+
+Point at(const Coords& world, int v)
+{
+    return { world.x[v], world.y[v], world.z[v] };
+}
+
+// Writes the nearest depth of triangle abc into the rows [top, bottom) of
+// the buffer, sampling at pixel centres. The stored depth is pushed back
+// by the triangle's slope over one pixel, so that edges lying on the
+// triangle are never hidden by it.
+void rasterize(Point a, Point b, Point c, const QRect& rect, int top, int bottom,
+               float* depth)
+{
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::abs(area) < 1e-6f)
+        return;
+    if (area < 0) {
+        std::swap(b, c);
+        area = -area;
+    }
+    const float ox = rect.left() + 0.5f, oy = rect.top() + 0.5f;
+    int x0 = qMax(0, int(std::floor(qMin(a.x, qMin(b.x, c.x)) - ox)));
+    int x1 = qMin(rect.width() - 1, int(std::ceil(qMax(a.x, qMax(b.x, c.x)) - ox)));
+    int y0 = qMax(top, int(std::floor(qMin(a.y, qMin(b.y, c.y)) - oy)));
+    int y1 = qMin(bottom - 1, int(std::ceil(qMax(a.y, qMax(b.y, c.y)) - oy)));
+    if (x0 > x1 || y0 > y1)
+        return;
+
+    // z as a plane over the screen
+    const float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+    const float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+    const float bias = qMax(std::abs(dzdx), std::abs(dzdy)) + 1e-2f;
+
+    // edge functions, positive inside
+    auto edge = [](const Point& p, const Point& q, float x, float y) {
+        return (q.x - p.x) * (y - p.y) - (q.y - p.y) * (x - p.x);
+    };
+    for (int py = y0; py <= y1; py++) {
+        float y = oy + py;
+        float* row = depth + py * rect.width();
+        for (int px = x0; px <= x1; px++) {
+            float x = ox + px;
+            if (edge(a, b, x, y) < 0 || edge(b, c, x, y) < 0 || edge(c, a, x, y) < 0)
+                continue;
+            float z = a.z + dzdx * (x - a.x) + dzdy * (y - a.y) + bias;
+            row[px] = qMin(row[px], z);
+        }
+    }
+}
+
+// Cuts the segment ab to the rectangle; false if nothing is left
+bool clip(Point& a, Point& b, const QRectF& rect)
+{
+    float t0 = 0, t1 = 1;
+    const float d[2] = { b.x - a.x, b.y - a.y };
+    const float from[2] = { a.x, a.y };
+    const float lo[2] = { float(rect.left()), float(rect.top()) };
+    const float hi[2] = { float(rect.right()), float(rect.bottom()) };
+    for (int k = 0; k < 2; k++) {
+        if (d[k] == 0) {
+            if (from[k] < lo[k] || from[k] > hi[k])
+                return false;
+            continue;
+        }
+        float ta = (lo[k] - from[k]) / d[k], tb = (hi[k] - from[k]) / d[k];
+        if (ta > tb)
+            std::swap(ta, tb);
+        t0 = qMax(t0, ta);
+        t1 = qMin(t1, tb);
+    }
+    if (t0 > t1)
+        return false;
+    const Point p = a, q = b;
+    auto lerp = [&](float t) {
+        return Point{ p.x + (q.x - p.x) * t, p.y + (q.y - p.y) * t, p.z + (q.z - p.z) * t };
+    };
+    a = lerp(t0);
+    b = lerp(t1);
+    return true;
+}
+
+} // namespace
+
+void DepthBuffer::render(const Polyhedron& mesh, const Coords& world,
+                         const BitMask& front, const QRect& newRect)
+{
+    rect = newRect;
+    depth.fill(std::numeric_limits<float>::max(), rect.width() * rect.height());
+    QVector<int> faces;
+    front.forEach([&](int i) { faces.push_back(i); });
+
+    // horizontal bands, each rasterizing every face that reaches into it
+    const int bands = qMin(rect.height(), threadCount() * 4);
+    float* buffer = depth.data();
+    pooledFor(bands, [&](int begin, int end) {
+        for (int band = begin; band < end; band++) {
+            int top = rect.height() * band / bands;
+            int bottom = rect.height() * (band + 1) / bands;
+            for (int i : qAsConst(faces)) {
+                const int* vs = mesh.polygon(i);
+                for (int j = 2; j < mesh.polygonSize(i); j++)
+                    rasterize(at(world, vs[0]), at(world, vs[j - 1]), at(world, vs[j]),
+                              rect, top, bottom, buffer);
+            }
+        }
+    }, 1);
+}
+
+bool DepthBuffer::isVisible(float x, float y, float z) const
+{
+    int px = int(std::floor(x - rect.left())), py = int(std::floor(y - rect.top()));
+    if (px < 0 || py < 0 || px >= rect.width() || py >= rect.height())
+        return true;
+    return z <= depth[py * rect.width() + px];
+}
+
+void findVisibleEdges(const Polyhedron& mesh, const Coords& world,
+                      const BitMask& front, const DepthBuffer& depth,
+                      QVector<QLineF>& lines, QVector<QLineF>& silhouettes)
+{
+    const QRectF area = QRectF(depth.area());
+    const int chunks = threadCount() * 4;
+    QVector<QVector<QLineF> > found(2 * chunks);
+    const int n = mesh.edges.size();
+    pooledFor(chunks, [&](int begin, int end) {
+        for (int c = begin; c < end; c++)
+            for (int e = int(qint64(n) * c / chunks); e < int(qint64(n) * (c + 1) / chunks); e++) {
+                const Edge& edge = mesh.edges[e];
+                bool isFront0 = front.test(edge.polygons[0]);
+                bool isFront1 = edge.polygons[1] >= 0 && front.test(edge.polygons[1]);
+                if (!isFront0 && !isFront1)
+                    continue;
+                QVector<QLineF>& out = found[2 * c + (isFront0 != isFront1)];
+                Point a = at(world, edge.vertices[0]), b = at(world, edge.vertices[1]);
+                if (!clip(a, b, area))
+                    continue;
+
+                // sample about once per pixel and keep the visible runs
+                int steps = qMax(1, int(std::ceil(qMax(std::abs(b.x - a.x),
+                                                       std::abs(b.y - a.y)))));
+                int runStart = -1;
+                QPointF start;
+                for (int s = 0; s <= steps + 1; s++) {
+                    float t = float(qMin(s, steps)) / steps;
+                    Point p = { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t,
+                                a.z + (b.z - a.z) * t };
+                    bool isVisible = s <= steps && depth.isVisible(p.x, p.y, p.z);
+                    if (isVisible && runStart < 0) {
+                        runStart = s;
+                        start = QPointF(p.x, p.y);
+                    }
+                    else if (!isVisible && runStart >= 0) {
+                        float u = float(s - 1) / steps;
+                        out.push_back({ start, QPointF(a.x + (b.x - a.x) * u,
+                                                       a.y + (b.y - a.y) * u) });
+                        runStart = -1;
+                    }
+                }
+            }
+    }, 1);
+    lines.resize(0);
+    silhouettes.resize(0);
+    for (int c = 0; c < chunks; c++) {
+        lines += found[2 * c];
+        silhouettes += found[2 * c + 1];
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef HIDDENLINE_H
+#define HIDDENLINE_H
+
+#include <QLineF>
+#include <QRect>
+#include "polyhedron.h"
+#include "transform.h"
+
+// Depth of the faces turned to the viewer, one sample per pixel, taken
+// from the transformed points; smaller z is nearer
+class DepthBuffer
+{
+public:
+    // rect is the visible area in the x, y of the transformed points
+    void render(const Polyhedron& mesh, const Coords& world,
+                const BitMask& front, const QRect& rect);
+
+    // whether a point at depth z lies on or in front of the faces at x, y
+    bool isVisible(float x, float y, float z) const;
+
+    const QRect& area() const { return rect; }
+
+private:
+    QRect rect;
+    QVector<float> depth;
+};
+
+// Edges of mesh with a polygon in front, cut down to the pieces that pass
+// the depth test. Edges between a front and a back facing polygon, or on
+// the border of a front one, are silhouettes and go to silhouettes.
+void findVisibleEdges(const Polyhedron& mesh, const Coords& world,
+                      const BitMask& front, const DepthBuffer& depth,
+                      QVector<QLineF>& lines, QVector<QLineF>& silhouettes);
+
+#endif // HIDDENLINE_H
@@ -0,0 +1,397 @@
+#include "hull.h"
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// Raw access to the cloud for the parallel readers
+struct Cloud
+{
+    const float *x, *y, *z;
+    int size;
+    explicit Cloud(const Coords& c)
+        : x(c.x.constData()), y(c.y.constData()), z(c.z.constData()), size(c.size()) {}
+};
+
+// points p with n·p = d for the unit normal n; zero when it is not defined
+struct Plane
+{
+    double x = 0, y = 0, z = 0, d = 0;
+
+    double distance(const Cloud& cloud, int i) const {
+        return x * cloud.x[i] + y * cloud.y[i] + z * cloud.z[i] - d;
+    }
+};
+
+// the plane of abc, facing the side from which abc runs counterclockwise
+Plane planeThrough(const Cloud& cloud, int a, int b, int c)
+{
+    const double ux = cloud.x[b] - cloud.x[a], uy = cloud.y[b] - cloud.y[a],
+                 uz = cloud.z[b] - cloud.z[a];
+    const double vx = cloud.x[c] - cloud.x[a], vy = cloud.y[c] - cloud.y[a],
+                 vz = cloud.z[c] - cloud.z[a];
+    Plane p;
+    p.x = uy * vz - uz * vy;
+    p.y = uz * vx - ux * vz;
+    p.z = ux * vy - uy * vx;
+    double length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+    if (length == 0)
+        return Plane();
+    p.x /= length; p.y /= length; p.z /= length;
+    p.d = p.x * cloud.x[a] + p.y * cloud.y[a] + p.z * cloud.z[a];
+    return p;
+}
+
+struct Face
+{
+    int v[3];           // counterclockwise seen from outside
+    int next[3];        // the face across the edge v[k] -> v[(k + 1) % 3]
+    Plane plane;
+    QVector<int> outside;
+    int farthest = -1;  // the point of outside farthest from the plane
+    int seenIn = -1;    // the last step in which the face was visible
+    bool isAlive = true;
+};
+
+// chunks for a parallel pass over count items, one unless it pays off
+int chunksFor(int count)
+{
+    return count >= 1 << 15 ? threadCount() * 4 : 1;
+}
+
+// the first i in [0, n) with the greatest score
+template <typename Score>
+int argMax(int n, Score score)
+{
+    const int chunks = chunksFor(n);
+    QVector<int> best(chunks, -1);
+    QVector<double> top(chunks, -std::numeric_limits<double>::max());
+    int* bestAt = best.data();
+    double* topAt = top.data();
+    parallelFor(chunks, [&](int begin, int end) {
+        for (int c = begin; c < end; c++)
+            for (int i = int(qint64(n) * c / chunks); i < int(qint64(n) * (c + 1) / chunks); i++) {
+                double s = score(i);
+                if (s > topAt[c]) {
+                    topAt[c] = s;
+                    bestAt[c] = i;
+                }
+            }
+    }, 1);
+    int result = best[0];
+    double s = top[0];
+    for (int c = 1; c < chunks; c++)
+        if (top[c] > s) {
+            s = top[c];
+            result = best[c];
+        }
+    return result;
+}
+
+// Hands each of the count points point(k) to the first target face it is
+// outside of and finds the farthest point of every target; the points
+// outside of none are inside the hull and dropped
+template <typename Point>
+void partition(int count, Point point, const Cloud& cloud, double eps,
+               QVector<Face>& faces, const QVector<int>& targets)
+{
+    const int t = targets.size();
+    QVector<Plane> planes(t);
+    for (int j = 0; j < t; j++)
+        planes[j] = faces[targets[j]].plane;
+    const Plane* plane = planes.constData();
+
+    const int chunks = chunksFor(count);
+    QVector<QVector<int> > found(chunks * t);
+    QVector<int> farthest(chunks * t, -1);
+    QVector<double> distance(chunks * t, 0);
+    QVector<int>* foundAt = found.data();
+    int* farthestAt = farthest.data();
+    double* distanceAt = distance.data();
+    parallelFor(chunks, [&](int begin, int end) {
+        for (int c = begin; c < end; c++)
+            for (int k = int(qint64(count) * c / chunks);
+                 k < int(qint64(count) * (c + 1) / chunks); k++) {
+                const int i = point(k);
+                for (int j = 0; j < t; j++) {
+                    double d = plane[j].distance(cloud, i);
+                    if (d <= eps)
+                        continue;
+                    const int slot = c * t + j;
+                    foundAt[slot].push_back(i);
+                    if (d > distanceAt[slot]) {
+                        distanceAt[slot] = d;
+                        farthestAt[slot] = i;
+                    }
+                    break;
+                }
+            }
+    }, 1);
+
+    for (int j = 0; j < t; j++) {
+        Face& face = faces[targets[j]];
+        int size = 0;
+        for (int c = 0; c < chunks; c++)
+            size += found[c * t + j].size();
+        face.outside.reserve(size);
+        double top = 0;
+        for (int c = 0; c < chunks; c++) {
+            const int slot = c * t + j;
+            face.outside += found[slot];
+            if (distance[slot] > top) {
+                top = distance[slot];
+                face.farthest = farthest[slot];
+            }
+        }
+    }
+}
+
+// The tetrahedron of the two axis extremes farthest apart, the point
+// farthest from their line and the point farthest from the plane of all
+// three; false when the cloud is flat
+bool tetrahedron(const Cloud& cloud, double eps, QVector<Face>& faces)
+{
+    const int n = cloud.size;
+    const float* axes[3] = { cloud.x, cloud.y, cloud.z };
+    int extremes[6];
+    for (int k = 0; k < 3; k++) {
+        const float* a = axes[k];
+        extremes[2 * k] = argMax(n, [a](int i) { return double(a[i]); });
+        extremes[2 * k + 1] = argMax(n, [a](int i) { return -double(a[i]); });
+    }
+    auto squaredDistance = [&](int i, int j) {
+        double dx = cloud.x[i] - cloud.x[j], dy = cloud.y[i] - cloud.y[j],
+               dz = cloud.z[i] - cloud.z[j];
+        return dx * dx + dy * dy + dz * dz;
+    };
+    int a = extremes[0], b = extremes[1];
+    for (int i : extremes)
+        for (int j : extremes)
+            if (squaredDistance(i, j) > squaredDistance(a, b)) {
+                a = i;
+                b = j;
+            }
+    const double ux = cloud.x[b] - cloud.x[a], uy = cloud.y[b] - cloud.y[a],
+                 uz = cloud.z[b] - cloud.z[a];
+    int c = argMax(n, [&](int i) {
+        double vx = cloud.x[i] - cloud.x[a], vy = cloud.y[i] - cloud.y[a],
+               vz = cloud.z[i] - cloud.z[a];
+        double cx = uy * vz - uz * vy, cy = uz * vx - ux * vz, cz = ux * vy - uy * vx;
+        return cx * cx + cy * cy + cz * cz;
+    });
+    const Plane base = planeThrough(cloud, a, b, c);
+    const int d = argMax(n, [&](int i) { return std::abs(base.distance(cloud, i)); });
+    if (std::abs(base.distance(cloud, d)) <= eps)
+        return false;
+    if (base.distance(cloud, d) > 0)
+        std::swap(b, c);
+
+    faces.resize(4);
+    const int corners[4][3] = { { a, b, c }, { a, d, b }, { b, d, c }, { c, d, a } };
+    for (int f = 0; f < 4; f++) {
+        for (int k = 0; k < 3; k++)
+            faces[f].v[k] = corners[f][k];
+        faces[f].plane = planeThrough(cloud, corners[f][0], corners[f][1], corners[f][2]);
+    }
+    for (int f = 0; f < 4; f++)
+        for (int k = 0; k < 3; k++)
+            for (int g = 0; g < 4; g++)
+                for (int e = 0; e < 3; e++)
+                    if (faces[g].v[e] == faces[f].v[(k + 1) % 3]
+                            && faces[g].v[(e + 1) % 3] == faces[f].v[k])
+                        faces[f].next[k] = g;
+    return true;
+}
+
+// Replaces the faces that have points outside of them by cones until
+// no point is left outside of the hull
+void grow(const Cloud& cloud, double eps, QVector<Face>& faces)
+{
+    struct HorizonEdge { int face, k; };
+    QVector<int> pending, visible, orphans, unused;
+    QVector<HorizonEdge> horizon;
+    QVector<int> created;
+    for (int f = 0; f < faces.size(); f++) {
+        faces[f].seenIn = -1;
+        if (!faces[f].isAlive)
+            unused.push_back(f);
+        else if (!faces[f].outside.isEmpty())
+            pending.push_back(f);
+    }
+    for (int step = 0; !pending.isEmpty(); step++) {
+        const int top = pending.takeLast();
+        if (!faces[top].isAlive || faces[top].outside.isEmpty())
+            continue;
+        const int eye = faces[top].farthest;
+
+        // the faces the eye sees, and the edges between them and the rest
+        visible = { top };
+        faces[top].seenIn = step;
+        horizon.resize(0);
+        for (int k = 0; k < visible.size(); k++) {
+            const int f = visible[k];
+            for (int e = 0; e < 3; e++) {
+                const int g = faces[f].next[e];
+                if (faces[g].seenIn == step)
+                    continue;
+                if (faces[g].plane.distance(cloud, eye) > 0) {
+                    faces[g].seenIn = step;
+                    visible.push_back(g);
+                }
+                else horizon.push_back({ f, e });
+            }
+        }
+
+        // a cone from the horizon to the eye
+        created.resize(0);
+        for (const HorizonEdge& h : qAsConst(horizon)) {
+            const int from = faces[h.face].v[h.k], to = faces[h.face].v[(h.k + 1) % 3];
+            const int g = faces[h.face].next[h.k];
+            // the slots of faces covered before are taken again
+            const int f = unused.isEmpty() ? faces.size() : unused.takeLast();
+            for (int e = 0; e < 3; e++)
+                if (faces[g].v[e] == to)
+                    faces[g].next[e] = f;
+            Face cone;
+            cone.v[0] = from;
+            cone.v[1] = to;
+            cone.v[2] = eye;
+            cone.next[0] = g;
+            cone.plane = planeThrough(cloud, from, to, eye);
+            if (f < faces.size())
+                faces[f] = cone;
+            else
+                faces.push_back(cone);
+            created.push_back(f);
+        }
+        // the horizon is short, a search is cheaper than a hash
+        for (int f : qAsConst(created))
+            for (int g : qAsConst(created))
+                if (faces[g].v[0] == faces[f].v[1]) {
+                    faces[f].next[1] = g;
+                    faces[g].next[2] = f;
+                }
+
+        // the points of the covered faces go to the cone
+        orphans.resize(0);
+        for (int f : qAsConst(visible)) {
+            for (int i : qAsConst(faces[f].outside))
+                if (i != eye)
+                    orphans.push_back(i);
+            faces[f].outside = QVector<int>();
+            faces[f].isAlive = false;
+            unused.push_back(f);
+        }
+        const int* orphan = orphans.constData();
+        partition(orphans.size(), [orphan](int k) { return orphan[k]; },
+                  cloud, eps, faces, created);
+        for (int f : qAsConst(created))
+            if (!faces[f].outside.isEmpty())
+                pending.push_back(f);
+    }
+}
+
+// the points farthest along each of the 26 directions to the corners,
+// edges and faces of a cube, the axes first, found in one pass
+QVector<int> extremePoints(const Cloud& cloud)
+{
+    static const int directions[13][3] = {
+        { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 },
+        { 1, 1, 0 }, { 1, -1, 0 }, { 1, 0, 1 }, { 1, 0, -1 }, { 0, 1, 1 }, { 0, 1, -1 },
+        { 1, 1, 1 }, { 1, 1, -1 }, { 1, -1, 1 }, { 1, -1, -1 },
+    };
+    const int n = cloud.size, chunks = chunksFor(n);
+    QVector<int> best(chunks * 26, 0);
+    QVector<float> top(chunks * 26, -std::numeric_limits<float>::max());
+    int* bestAt = best.data();
+    float* topAt = top.data();
+    parallelFor(chunks, [&](int begin, int end) {
+        for (int c = begin; c < end; c++)
+            for (int i = int(qint64(n) * c / chunks); i < int(qint64(n) * (c + 1) / chunks); i++)
+                for (int k = 0; k < 13; k++) {
+                    const int* d = directions[k];
+                    const float s = d[0] * cloud.x[i] + d[1] * cloud.y[i] + d[2] * cloud.z[i];
+                    const int slot = c * 26 + 2 * k;
+                    if (s > topAt[slot]) {
+                        topAt[slot] = s;
+                        bestAt[slot] = i;
+                    }
+                    if (-s > topAt[slot + 1]) {
+                        topAt[slot + 1] = -s;
+                        bestAt[slot + 1] = i;
+                    }
+                }
+    }, 1);
+    QVector<int> result(26);
+    for (int k = 0; k < 26; k++) {
+        int c = 0;
+        for (int other = 1; other < chunks; other++)
+            if (top[other * 26 + k] > top[c * 26 + k])
+                c = other;
+        result[k] = best[c * 26 + k];
+    }
+    return result;
+}
+
+} // namespace
+
+Polyhedron convexHull(const Coords& points)
+{
+    const Cloud cloud(points);
+    const int n = cloud.size;
+    Polyhedron hull;
+    if (n < 4)
+        return hull;
+
+    const QVector<int> extremes = extremePoints(cloud);
+    const float* axes[3] = { cloud.x, cloud.y, cloud.z };
+    double scale = 0;
+    for (int k = 0; k < 3; k++)
+        scale += qMax(std::abs(axes[k][extremes[2 * k]]),
+                      std::abs(axes[k][extremes[2 * k + 1]]));
+    const double eps = scale * FLT_EPSILON;
+
+    // The hull of the extremes comes first: it is cheap and leaves most of
+    // the cloud inside, so that the full pass over the cloud drops most
+    // points at once instead of handing them on from face to face
+    Coords seedPoints;
+    for (int i : extremes)
+        seedPoints.push_back(points[i]);
+    const Cloud seed(seedPoints);
+    QVector<Face> faces;
+    if (tetrahedron(seed, eps, faces)) {
+        partition(seed.size, [](int k) { return k; }, seed, eps, faces, { 0, 1, 2, 3 });
+        grow(seed, eps, faces);
+        for (Face& face : faces)
+            for (int& v : face.v)
+                v = extremes[v];
+    }
+    else if (!tetrahedron(cloud, eps, faces))
+        return hull;
+    QVector<int> alive;
+    for (int f = 0; f < faces.size(); f++)
+        if (faces[f].isAlive)
+            alive.push_back(f);
+    partition(n, [](int k) { return k; }, cloud, eps, faces, alive);
+    grow(cloud, eps, faces);
+
+    // the vertices keep the order they had in the cloud
+    QVector<int> remap(n, -1);
+    for (const Face& face : qAsConst(faces))
+        if (face.isAlive)
+            for (int v : face.v)
+                remap[v] = n;
+    for (int i = 0; i < n; i++)
+        if (remap[i] == n)
+            remap[i] = hull.addVertex(points[i]);
+    for (const Face& face : qAsConst(faces))
+        if (face.isAlive) {
+            for (int v : face.v)
+                hull.indices.push_back(remap[v]);
+            hull.offsets.push_back(hull.indices.size());
+        }
+    hull.buildNormals(1);
+    hull.randomizeColors();
+    hull.buildAdjacency();
+    return hull;
+}
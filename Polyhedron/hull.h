@@ -0,0 +1,18 @@
+#ifndef HULL_H
+#define HULL_H
+
+#include "polyhedron.h"
+
+// Quickhull. Every face keeps the set of points outside of it; the face
+// whose farthest point is taken next is replaced by a cone from that point
+// to the horizon, and the points of the faces it covers are handed to the
+// new faces. Large sets are partitioned from several threads at once,
+// which is where nearly all the time goes on big clouds. Points nearer to
+// a face than float precision count as lying on it.
+
+// Convex hull of the cloud as triangles in the cloud's own coordinates,
+// keeping only the points on the hull, with unit normals, colors and
+// adjacency built. Empty when the cloud spans no volume.
+Polyhedron convexHull(const Coords& cloud);
+
+#endif // HULL_H
@@ -0,0 +1,128 @@
+#include "lineraster.h"
+#include <cmath>
+#include "parallel.h"
+
+namespace {
+
+// x * a / 255 on all four channels of x at once
+inline quint32 byteMul(quint32 x, quint32 a)
+{
+    quint32 rb = (x & 0xff00ff) * a;
+    rb = (rb + (rb >> 8 & 0xff00ff) + 0x800080) >> 8 & 0xff00ff;
+    quint32 ag = (x >> 8 & 0xff00ff) * a;
+    ag = (ag + (ag >> 8 & 0xff00ff) + 0x800080) & 0xff00ff00;
+    return rb | ag;
+}
+
+// The rows [top, bottom) and columns [left, right) of the image one
+// thread draws into
+struct Band
+{
+    uchar* bits;
+    int bytesPerLine;
+    int left, right, top, bottom;
+    QRgb color;     // premultiplied
+
+    void plot(int x, int y, float coverage) const
+    {
+        if (x < left || x >= right || y < top || y >= bottom || coverage <= 0)
+            return;
+        QRgb* p = reinterpret_cast<QRgb*>(bits + size_t(y) * bytesPerLine) + x;
+        const quint32 a = quint32(qMin(coverage, 1.0f) * 255 + 0.5f);
+        *p = byteMul(color, a) + byteMul(*p, 255 - a);
+    }
+};
+
+// Wu's line from (x0, y0) to (x1, y1), stepping along the longer axis u
+// and spreading each step over the pixels across it on the other axis v.
+// A line one pixel wide is 1 / cos thick along v, so a step covers more
+// than one pixel in all as the line turns from the axis. Only the steps
+// that can reach into the band are taken.
+void drawLine(const Band& band, float x0, float y0, float x1, float y1)
+{
+    // pixel centres at whole numbers
+    x0 -= 0.5f; y0 -= 0.5f;
+    x1 -= 0.5f; y1 -= 0.5f;
+    const bool isSteep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    if (isSteep) {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    if (x1 - x0 <= 0)
+        return;
+    const float gradient = (y1 - y0) / (x1 - x0);
+    const float half = 0.5f * std::sqrt(1 + gradient * gradient);
+    // the pixels at u that the span of v around y covers, weighed
+    auto step = [&](int u, float y, float weight) {
+        const float lo = y - half, hi = y + half;
+        const int first = int(std::floor(lo + 0.5f)), last = int(std::floor(hi + 0.5f));
+        for (int v = first; v <= last; v++) {
+            const float coverage = (qMin(hi, v + 0.5f) - qMax(lo, v - 0.5f)) * weight;
+            if (isSteep)
+                band.plot(v, u, coverage);
+            else
+                band.plot(u, v, coverage);
+        }
+    };
+
+    // the ends, weighed by how far into their pixel the line reaches
+    const int u0 = int(std::lround(x0)), u1 = int(std::lround(x1));
+    if (u0 == u1) {
+        step(u0, (y0 + y1) / 2, x1 - x0);
+        return;
+    }
+    step(u0, y0 + gradient * (u0 - x0), u0 + 0.5f - x0);
+    step(u1, y1 + gradient * (u1 - x1), x1 - (u1 - 0.5f));
+
+    // the steps between, cut to where they can reach the band
+    const float start = y0 + gradient * (u0 + 1 - x0);
+    int from = qMax(u0 + 1, isSteep ? band.top : band.left);
+    int to = qMin(u1 - 1, (isSteep ? band.bottom : band.right) - 1);
+    const float vMin = (isSteep ? band.left : band.top) - 1 - half;
+    const float vMax = (isSteep ? band.right : band.bottom) + half;
+    if (from > to)
+        return;
+    if (gradient != 0) {
+        float a = u0 + 1 + (vMin - start) / gradient;
+        float b = u0 + 1 + (vMax - start) / gradient;
+        if (a > b)
+            std::swap(a, b);
+        // near an axis the gradient is tiny and a and b are far beyond
+        // what an int holds, so they are cut to the steps first
+        from = int(std::floor(qBound(float(from), a, float(to))));
+        to = int(std::ceil(qBound(float(from), b, float(to))));
+    }
+    else if (start < vMin || start > vMax)
+        return;
+    for (int u = from; u <= to; u++)
+        step(u, start + gradient * (u - u0 - 1), 1);
+}
+
+} // namespace
+
+void rasterizeLines(QImage& image, const QVector<QLineF>& lines, QRgb color,
+                    const QPointF& offset, const QRect& clip)
+{
+    const QRect area = clip & image.rect();
+    if (area.isEmpty() || lines.isEmpty())
+        return;
+    uchar* bits = image.bits();
+    const int bytesPerLine = image.bytesPerLine();
+    const float ox = offset.x(), oy = offset.y();
+    pooledFor(area.height(), [&](int begin, int end) {
+        const Band band = { bits, bytesPerLine, area.left(), area.right() + 1,
+                            area.top() + begin, area.top() + end, qPremultiply(color) };
+        for (const QLineF& line : lines) {
+            const float x0 = line.x1() + ox, y0 = line.y1() + oy;
+            const float x1 = line.x2() + ox, y1 = line.y2() + oy;
+            if (qMax(y0, y1) < band.top - 1 || qMin(y0, y1) > band.bottom + 1
+             || qMax(x0, x1) < band.left - 1 || qMin(x0, x1) > band.right + 1)
+                continue;
+            drawLine(band, x0, y0, x1, y1);
+        }
+    }, 64);
+}
@@ -0,0 +1,18 @@
+#ifndef LINERASTER_H
+#define LINERASTER_H
+
+#include <QImage>
+#include <QLineF>
+#include <QRect>
+#include <QVector>
+
+// Draws the lines one pixel wide into an ARGB32 premultiplied image with
+// Xiaolin Wu's algorithm, blending color over every pixel by how much of
+// it a line covers, which is close to what an antialiased QPainter draws
+// with a one pixel pen. Lines are moved by offset and cut to clip. Bands
+// of rows are drawn in parallel; with a single color the order lines are
+// blended in does not change the result.
+void rasterizeLines(QImage& image, const QVector<QLineF>& lines, QRgb color,
+                    const QPointF& offset, const QRect& clip);
+
+#endif // LINERASTER_H
@@ -1,5 +1,8 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "meshimport.h"
+#include <QFileDialog>
+#include <QMessageBox>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -56,12 +59,62 @@ MainWindow::MainWindow(QWidget *parent)
         ra->setShift(E);
     });
 
-    connect(ui->figure_comboBox, &QComboBox::currentTextChanged,
-            ra, [this](const QString& var) {
+    auto generateFigure = [this]() {
+        QString var = ui->figure_comboBox->currentText();
+        int level = ui->detail_spinBox->value();
         if (var == "Cube")
             ra->setFigure(Polyhedron::GenerateCube());
         else if (var == "Pyramid")
             ra->setFigure(Polyhedron::GeneratePyramid());
+        else if (var == "Geodesic sphere")
+            ra->setFigure(Polyhedron::GenerateGeodesicSphere(level));
+        else if (var == "Torus")
+            ra->setFigure(Polyhedron::GenerateTorus(level));
+        else if (var == "Superquadric")
+            ra->setFigure(Polyhedron::GenerateSuperquadric(level));
+        else if (var == "Cube (Catmull-Clark)")
+            ra->setFigure(Polyhedron::GenerateCube().subdividedCatmullClark(level));
+        else if (var == "Pyramid (Loop)")
+            ra->setFigure(Polyhedron::GeneratePyramid().subdividedLoop(level));
+        else if (var == "Cube field")
+            ra->setScene(Scene::GenerateCubeField(2 + 2 * level));
+    };
+    connect(ui->figure_comboBox, &QComboBox::currentTextChanged,
+            ra, [this, generateFigure]() {
+        isShowingImport = false;
+        generateFigure();
+    });
+    // the detail only remakes the figures it shapes, never an opened mesh
+    connect(ui->detail_spinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            ra, [this, generateFigure]() {
+        QString var = ui->figure_comboBox->currentText();
+        if (!isShowingImport && var != "Cube" && var != "Pyramid")
+            generateFigure();
+    });
+
+    connect(ui->open_pushButton, &QPushButton::clicked, ra, [this]() {
+        QString fileName = QFileDialog::getOpenFileName(
+                    this, "Open mesh", QString(), "Meshes (*.obj *.ply *.stl)");
+        if (fileName.isEmpty())
+            return;
+        Polyhedron mesh;
+        QString error;
+        if (importMesh(fileName, mesh, &error)) {
+            isShowingImport = true;
+            ra->setFigure(mesh);
+        }
+        else
+            QMessageBox::warning(this, "Open mesh", error);
+    });
+
+    connect(ui->export_pushButton, &QPushButton::clicked, ra, [this]() {
+        QString fileName = QFileDialog::getSaveFileName(
+                    this, "Export image", QString(), "Vector images (*.svg *.pdf)");
+        if (fileName.isEmpty())
+            return;
+        QString error;
+        if (!ra->exportImage(fileName, &error))
+            QMessageBox::warning(this, "Export image", error);
     });
 
     connect(ui->none_radioButton, &QRadioButton::clicked,
@@ -76,6 +129,8 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(ui->wireframe_checkBox, &QCheckBox::clicked,
             ra, &RenderArea::setIsDrawWireframe);
+    connect(ui->hiddenLines_checkBox, &QCheckBox::clicked,
+            ra, &RenderArea::setIsHidingLines);
     connect(ui->normals_checkBox, &QCheckBox::clicked,
             ra, &RenderArea::setIsDrawingNormals);
     connect(ui->normalMethod_checkBox, &QCheckBox::clicked,
@@ -85,6 +140,8 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(ui->ortho_radioButton, &QRadioButton::clicked,
             ra, &RenderArea::setOrthoView);
+    connect(ui->perspective_radioButton, &QRadioButton::clicked,
+            ra, &RenderArea::setPerspectiveView);
     connect(ui->front_radioButton, &QRadioButton::clicked,
             ra, &RenderArea::setFrontView);
     connect(ui->side_radioButton, &QRadioButton::clicked,
@@ -93,6 +150,17 @@ MainWindow::MainWindow(QWidget *parent)
             ra, &RenderArea::setTopView);
     connect(ui->isometry_pushButton, &QRadioButton::clicked,
             ra, &RenderArea::positIsometric);
+    connect(ui->quadView_checkBox, &QCheckBox::clicked,
+            ra, &RenderArea::setIsQuadView);
+    connect(ui->stats_checkBox, &QCheckBox::clicked,
+            ra, &RenderArea::setIsShowingStats);
+
+    connect(ra, &RenderArea::selectionChanged, this, [this](int polygon, int vertex) {
+        if (polygon < 0)
+            ui->statusbar->clearMessage();
+        else
+            ui->statusbar->showMessage(tr("Face %1, vertex %2").arg(polygon).arg(vertex));
+    });
 
     connect(ra, &RenderArea::scaleChanged, this, [this](QMatrix4x4 sc) {
         ui->scaleX_doubleSpinBox->blockSignals(true);
@@ -28,5 +28,6 @@ private:
     RenderArea *ra;
     QSize margin;
     double ra_ratio;
+    bool isShowingImport = false;  // an opened mesh, not the chosen figure
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,201 @@
+#include "meshcache.h"
+#include <QDateTime>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char magic[8] = { 'P', 'O', 'L', 'Y', 'M', 'E', 'S', 'H' };
+const quint32 version = 2;      // 2: meshes are reordered for locality
+const quint32 byteOrderMark = 0x01020304;
+const qint64 alignment = 64;
+
+enum Section {
+    PointsX, PointsY, PointsZ, NormalsX, NormalsY, NormalsZ,
+    Indices, Offsets, Colors, VertexOffsets, VertexPolygons,
+    SectionCount
+};
+
+struct Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    qint64 sourceSize;
+    qint64 sourceModified;   // ms since epoch
+    qint32 vertexCount;
+    qint32 polygonCount;
+    qint32 cornerCount;
+    qint32 reserved;
+    float lower[3];
+    float upper[3];
+    qint64 sections[SectionCount][2]; // byte offset and length
+};
+
+qint64 aligned(qint64 at)
+{
+    return (at + alignment - 1) / alignment * alignment;
+}
+
+// element counts every section must have
+void expectedSizes(const Header& h, qint64 sizes[SectionCount])
+{
+    for (Section s : { PointsX, PointsY, PointsZ, VertexOffsets })
+        sizes[s] = qint64(h.vertexCount) * 4;
+    sizes[VertexOffsets] += 4;
+    for (Section s : { NormalsX, NormalsY, NormalsZ, Colors })
+        sizes[s] = qint64(h.polygonCount) * 4;
+    sizes[Offsets] = (qint64(h.polygonCount) + 1) * 4;
+    sizes[Indices] = sizes[VertexPolygons] = qint64(h.cornerCount) * 4;
+}
+
+template <typename T>
+void load(QVector<T>& array, const uchar* data, const qint64 section[2])
+{
+    array.resize(int(section[1] / sizeof(T)));
+    memcpy(array.data(), data + section[0], section[1]);
+}
+
+// Whether everything the mesh indexes is there, in one pass over each
+// array: polygons of at least three corners one after another, corners
+// that are vertices, and around each vertex exactly the polygons it is a
+// corner of. A damaged cache that kept its size and sections fails here
+// rather than sending the renderer out of bounds.
+bool isConsistent(const Polyhedron& mesh)
+{
+    const int V = mesh.vertexCount(), F = mesh.polygonCount();
+    if (mesh.offsets.first() != 0 || mesh.offsets.last() != mesh.indices.size())
+        return false;
+    for (int i = 0; i < F; i++)
+        if (mesh.polygonSize(i) < 3)
+            return false;
+    QVector<int> corners(V, 0);
+    for (int v : mesh.indices) {
+        if (v < 0 || v >= V)
+            return false;
+        corners[v]++;
+    }
+    if (mesh.vertexOffsets.first() != 0)
+        return false;
+    for (int v = 0; v < V; v++) {
+        const int begin = mesh.vertexOffsets[v], end = mesh.vertexOffsets[v + 1];
+        if (end - begin != corners[v])
+            return false;
+        for (int k = begin; k < end; k++) {
+            const int i = mesh.vertexPolygons[k];
+            if (i < 0 || i >= F)
+                return false;
+            const int* vs = mesh.polygon(i);
+            if (std::find(vs, vs + mesh.polygonSize(i), v) == vs + mesh.polygonSize(i))
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool writeMeshCache(const QString& cacheName, const QFileInfo& source,
+                    const Polyhedron& mesh)
+{
+    Header header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, magic, sizeof magic);
+    header.version = version;
+    header.byteOrder = byteOrderMark;
+    header.sourceSize = source.size();
+    header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    header.vertexCount = mesh.vertexCount();
+    header.polygonCount = mesh.polygonCount();
+    header.cornerCount = mesh.indices.size();
+    QVector3D lower, upper;
+    mesh.bounds(lower, upper);
+    for (int c = 0; c < 3; c++) {
+        header.lower[c] = lower[c];
+        header.upper[c] = upper[c];
+    }
+
+    const void* arrays[SectionCount] = {
+        mesh.points.x.constData(),  mesh.points.y.constData(),  mesh.points.z.constData(),
+        mesh.normals.x.constData(), mesh.normals.y.constData(), mesh.normals.z.constData(),
+        mesh.indices.constData(),   mesh.offsets.constData(),   mesh.colors.constData(),
+        mesh.vertexOffsets.constData(), mesh.vertexPolygons.constData(),
+    };
+    const qint64 sizes[SectionCount] = {
+        mesh.points.x.size() * 4,  mesh.points.y.size() * 4,  mesh.points.z.size() * 4,
+        mesh.normals.x.size() * 4, mesh.normals.y.size() * 4, mesh.normals.z.size() * 4,
+        mesh.indices.size() * 4,   mesh.offsets.size() * 4,   mesh.colors.size() * 4,
+        mesh.vertexOffsets.size() * 4, mesh.vertexPolygons.size() * 4,
+    };
+    qint64 expected[SectionCount];
+    expectedSizes(header, expected);
+    qint64 at = aligned(sizeof header);
+    for (int s = 0; s < SectionCount; s++) {
+        if (sizes[s] != expected[s])
+            return false;
+        header.sections[s][0] = at;
+        header.sections[s][1] = sizes[s];
+        at = aligned(at + sizes[s]);
+    }
+
+    QSaveFile file(cacheName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof header);
+    qint64 written = sizeof header;
+    for (int s = 0; s < SectionCount; s++) {
+        file.write(QByteArray(int(header.sections[s][0] - written), 0));
+        file.write(static_cast<const char*>(arrays[s]), sizes[s]);
+        written = header.sections[s][0] + sizes[s];
+    }
+    return file.commit();
+}
+
+bool readMeshCache(const QString& cacheName, const QFileInfo& source,
+                   Polyhedron& mesh)
+{
+    QFile file(cacheName);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(Header)))
+        return false;
+    const qint64 size = file.size();
+    const uchar* data = file.map(0, size);
+    if (!data)
+        return false;
+    const Header& header = *reinterpret_cast<const Header*>(data);
+
+    bool ok = !memcmp(header.magic, magic, sizeof magic)
+           && header.version == version
+           && header.byteOrder == byteOrderMark
+           && header.sourceSize == source.size()
+           && header.sourceModified == source.lastModified().toMSecsSinceEpoch()
+           && header.vertexCount >= 0 && header.polygonCount >= 0
+           && header.cornerCount >= 0;
+    qint64 expected[SectionCount];
+    expectedSizes(header, expected);
+    for (int s = 0; ok && s < SectionCount; s++)
+        ok = header.sections[s][1] == expected[s]
+          && header.sections[s][0] % alignment == 0
+          && header.sections[s][0] >= qint64(sizeof header)
+          && header.sections[s][0] <= size - expected[s];
+    if (ok) {
+        Polyhedron result;
+        load(result.points.x,  data, header.sections[PointsX]);
+        load(result.points.y,  data, header.sections[PointsY]);
+        load(result.points.z,  data, header.sections[PointsZ]);
+        load(result.normals.x, data, header.sections[NormalsX]);
+        load(result.normals.y, data, header.sections[NormalsY]);
+        load(result.normals.z, data, header.sections[NormalsZ]);
+        load(result.indices,   data, header.sections[Indices]);
+        load(result.offsets,   data, header.sections[Offsets]);
+        load(result.colors,    data, header.sections[Colors]);
+        load(result.vertexOffsets,  data, header.sections[VertexOffsets]);
+        load(result.vertexPolygons, data, header.sections[VertexPolygons]);
+        ok = isConsistent(result);
+        if (ok)
+            mesh = result;
+    }
+    file.unmap(const_cast<uchar*>(data));
+    return ok;
+}
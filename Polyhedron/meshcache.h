@@ -0,0 +1,24 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <QFileInfo>
+#include "polyhedron.h"
+
+// Binary image of a ready-to-draw mesh. A fixed header with the counts,
+// the bounds and the source file's size and time stamp is followed by the
+// raw mesh arrays, each starting on a 64-byte boundary, in host byte
+// order. Loading maps the file and copies the arrays out whole, without
+// parsing anything.
+
+// Writes mesh to cacheName, tagged with the state of source; returns
+// false if the file could not be written
+bool writeMeshCache(const QString& cacheName, const QFileInfo& source,
+                    const Polyhedron& mesh);
+
+// Fills mesh from cacheName if the cache is intact and was made from
+// source as it is now. A cache whose topology indexes out of its arrays
+// is refused like a stale one, and the source is read again.
+bool readMeshCache(const QString& cacheName, const QFileInfo& source,
+                   Polyhedron& mesh);
+
+#endif // MESHCACHE_H
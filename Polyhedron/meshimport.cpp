@@ -0,0 +1,883 @@
+#include "meshimport.h"
+#include "meshcache.h"
+#include "hull.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QtEndian>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <climits>
+
+namespace {
+
+bool fail(QString* error, const QString& message)
+{
+    if (error) *error = message;
+    return false;
+}
+
+// ---------------------------------------------------------------- text
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipBlanks(const char* p, const char* end)
+{
+    while (p < end && isBlank(*p)) p++;
+    return p;
+}
+
+inline const char* skipToken(const char* p, const char* end)
+{
+    while (p < end && !isBlank(*p) && *p != '\n') p++;
+    return p;
+}
+
+// position of the line feed ending the line at p, or end
+inline const char* lineEnd(const char* p, const char* end)
+{
+    const void* lf = memchr(p, '\n', end - p);
+    return lf ? static_cast<const char*>(lf) : end;
+}
+
+inline const char* nextLine(const char* p, const char* end)
+{
+    p = lineEnd(p, end);
+    return p < end ? p + 1 : end;
+}
+
+// Locale-independent decimal reader, several times faster than strtof.
+// Returns the position after the number, or null if there is none.
+const char* readFloat(const char* p, const char* end, float& value)
+{
+    static const double powers[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    double mantissa = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    for (; p < end && unsigned(*p - '0') < 10; p++, hasDigits = true)
+        mantissa = mantissa * 10 + (*p - '0');
+    if (p < end && *p == '.')
+        for (p++; p < end && unsigned(*p - '0') < 10; p++, hasDigits = true) {
+            mantissa = mantissa * 10 + (*p - '0');
+            exponent--;
+        }
+    if (!hasDigits)
+        return nullptr;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negativeExp = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            negativeExp = *q++ == '-';
+        int e = 0;
+        const char* digits = q;
+        for (; q < end && unsigned(*q - '0') < 10; q++)
+            e = qMin(e * 10 + (*q - '0'), 1000);
+        if (q != digits) {
+            exponent += negativeExp ? -e : e;
+            p = q;
+        }
+    }
+    if (exponent < 0)
+        mantissa = exponent >= -22 ? mantissa / powers[-exponent]
+                                   : mantissa * std::pow(10.0, exponent);
+    else if (exponent > 0)
+        mantissa = exponent <= 22 ? mantissa * powers[exponent]
+                                  : mantissa * std::pow(10.0, exponent);
+    value = float(negative ? -mantissa : mantissa);
+    return p;
+}
+
+const char* readInt(const char* p, const char* end, qint64& value)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    const char* digits = p;
+    qint64 v = 0;
+    for (; p < end && unsigned(*p - '0') < 10; p++)
+        v = qMin(v * 10 + (*p - '0'), qint64(INT_MAX) + 1);
+    if (p == digits)
+        return nullptr;
+    value = negative ? -v : v;
+    return p;
+}
+
+int chunkCount(qint64 size)
+{
+    return int(qBound(qint64(1), size >> 20, qint64(threadCount() * 4)));
+}
+
+// Cuts [begin, end) into pieces that start at line starts
+QVector<const char*> splitLines(const char* begin, const char* end, int pieces)
+{
+    QVector<const char*> cuts = { begin };
+    for (int i = 1; i < pieces; i++) {
+        const char* p = begin + (end - begin) * i / pieces;
+        p = qMax(p, cuts.last());
+        if (p > begin && p < end && p[-1] != '\n')
+            p = nextLine(p, end);
+        cuts.push_back(p);
+    }
+    cuts.push_back(end);
+    return cuts;
+}
+
+// start of the line following the n-th one from p, or null if the text
+// ends sooner; the last line may lack its line feed
+const char* skipLines(const char* p, const char* end, qint64 n)
+{
+    for (; n > 0; n--) {
+        if (p >= end)
+            return nullptr;
+        p = nextLine(p, end);
+    }
+    return p;
+}
+
+// ------------------------------------------------------------- helpers
+
+bool allocate(Polyhedron& mesh, qint64 vertices, qint64 polygons, qint64 corners,
+              QString* error)
+{
+    if (vertices > INT_MAX || polygons >= INT_MAX || corners > INT_MAX)
+        return fail(error, QStringLiteral("Mesh is too large"));
+    mesh.points.resize(int(vertices));
+    mesh.indices.resize(int(corners));
+    mesh.offsets.resize(int(polygons) + 1);
+    mesh.offsets[0] = 0;
+    return true;
+}
+
+bool indicesInRange(const Polyhedron& mesh)
+{
+    const int* idx = mesh.indices.constData();
+    const uint n = uint(mesh.vertexCount());
+    std::atomic<bool> ok(true);
+    parallelFor(mesh.indices.size(), [&](int begin, int end) {
+        for (int k = begin; k < end; k++)
+            if (uint(idx[k]) >= n) {
+                ok = false;
+                return;
+            }
+    });
+    return ok;
+}
+
+// removes the polygons with fewer than three corners
+void dropDegenerate(Polyhedron& mesh)
+{
+    int kept = 0, corner = 0;
+    for (int i = 0; i < mesh.polygonCount(); i++) {
+        int from = mesh.offsets[i], size = mesh.offsets[i + 1] - from;
+        if (size < 3)
+            continue;
+        if (corner != from)
+            memmove(mesh.indices.data() + corner, mesh.indices.constData() + from,
+                    size * sizeof(int));
+        corner += size;
+        mesh.offsets[++kept] = corner;
+    }
+    mesh.offsets.resize(kept + 1);
+    mesh.indices.resize(corner);
+}
+
+// welds positions and renumbers the polygon corners accordingly
+void weld(Polyhedron& mesh)
+{
+    QVector<int> remap = weldVertices(mesh.points);
+    const int* r = remap.constData();
+    int* idx = mesh.indices.data();
+    parallelFor(mesh.indices.size(), [&](int begin, int end) {
+        for (int k = begin; k < end; k++)
+            idx[k] = r[idx[k]];
+    });
+}
+
+// ----------------------------------------------------------------- OBJ
+
+struct ObjChunk
+{
+    qint64 vertices = 0, polygons = 0, corners = 0;
+};
+
+inline bool isObjTag(const char* p, const char* end, char tag)
+{
+    return p + 1 < end && p[0] == tag && isBlank(p[1]);
+}
+
+int countTokens(const char* p, const char* end)
+{
+    int n = 0;
+    for (p = skipBlanks(p, end); p < end; p = skipBlanks(skipToken(p, end), end))
+        n++;
+    return n;
+}
+
+void countObj(const char* p, const char* end, ObjChunk& chunk)
+{
+    for (; p < end; p = nextLine(p, end)) {
+        const char* line = skipBlanks(p, end);
+        if (isObjTag(line, end, 'v'))
+            chunk.vertices++;
+        else if (isObjTag(line, end, 'f')) {
+            int n = countTokens(line + 2, lineEnd(line, end));
+            if (n >= 3) {
+                chunk.polygons++;
+                chunk.corners += n;
+            }
+        }
+    }
+}
+
+// Fills the chunk's share of the preallocated arrays; base holds the
+// vertices, polygons and corners of all preceding chunks
+bool parseObj(const char* p, const char* end, const ObjChunk& base,
+              int vertexTotal, Polyhedron& mesh)
+{
+    float *x = mesh.points.x.data(), *y = mesh.points.y.data(), *z = mesh.points.z.data();
+    int* idx = mesh.indices.data();
+    int* offsets = mesh.offsets.data();
+    int v = int(base.vertices), f = int(base.polygons), c = int(base.corners);
+    for (; p < end; p = nextLine(p, end)) {
+        const char* line = skipBlanks(p, end);
+        const char* eol = lineEnd(line, end);
+        if (isObjTag(line, eol, 'v')) {
+            const char* q = line + 2;
+            if (!(q = readFloat(skipBlanks(q, eol), eol, x[v]))
+             || !(q = readFloat(skipBlanks(q, eol), eol, y[v]))
+             || !(q = readFloat(skipBlanks(q, eol), eol, z[v])))
+                return false;
+            v++;
+        }
+        else if (isObjTag(line, eol, 'f')) {
+            if (countTokens(line + 2, eol) < 3)
+                continue;
+            for (const char* q = skipBlanks(line + 2, eol); q < eol;
+                 q = skipBlanks(skipToken(q, eol), eol)) {
+                qint64 i;
+                if (!readInt(q, eol, i) || i == 0)
+                    return false;
+                i = i > 0 ? i - 1 : v + i;
+                if (i < 0 || i >= vertexTotal)
+                    return false;
+                idx[c++] = int(i);
+            }
+            offsets[++f] = c;
+        }
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------- PLY
+
+enum PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+struct PlyProperty
+{
+    QByteArray name;
+    PlyType type = Invalid;
+    PlyType countType = Invalid; // set for lists only
+    bool isList() const { return countType != Invalid; }
+};
+
+struct PlyElement
+{
+    QByteArray name;
+    qint64 count = 0;
+    QVector<PlyProperty> properties;
+    bool hasLists() const {
+        for (const auto& p : properties)
+            if (p.isList()) return true;
+        return false;
+    }
+    int indexOf(const QByteArray& name) const {
+        for (int i = 0; i < properties.size(); i++)
+            if (properties[i].name == name) return i;
+        return -1;
+    }
+};
+
+PlyType plyType(const QByteArray& name)
+{
+    static const QHash<QByteArray, PlyType> types = {
+        { "char",  Int8  }, { "int8",    Int8    }, { "uchar",  UInt8   },
+        { "uint8", UInt8 }, { "short",   Int16   }, { "int16",  Int16   },
+        { "ushort", UInt16 }, { "uint16", UInt16 }, { "int",    Int32   },
+        { "int32", Int32 }, { "uint",    UInt32  }, { "uint32", UInt32  },
+        { "float", Float32 }, { "float32", Float32 }, { "double", Float64 },
+        { "float64", Float64 },
+    };
+    return types.value(name, Invalid);
+}
+
+int plySize(PlyType type)
+{
+    static const int sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+    return sizes[type];
+}
+
+template <typename T>
+inline T plyRaw(const uchar* p, bool bigEndian)
+{
+    return bigEndian ? qFromBigEndian<T>(p) : qFromLittleEndian<T>(p);
+}
+
+double plyRead(const uchar* p, PlyType type, bool bigEndian)
+{
+    switch (type) {
+    case Int8:    return qint8(*p);
+    case UInt8:   return *p;
+    case Int16:   return plyRaw<qint16>(p, bigEndian);
+    case UInt16:  return plyRaw<quint16>(p, bigEndian);
+    case Int32:   return plyRaw<qint32>(p, bigEndian);
+    case UInt32:  return plyRaw<quint32>(p, bigEndian);
+    case Float32: {
+        quint32 u = plyRaw<quint32>(p, bigEndian);
+        float f;
+        memcpy(&f, &u, sizeof f);
+        return f;
+    }
+    case Float64: {
+        quint64 u = plyRaw<quint64>(p, bigEndian);
+        double d;
+        memcpy(&d, &u, sizeof d);
+        return d;
+    }
+    default:      return 0;
+    }
+}
+
+struct PlyHeader
+{
+    enum Format { Ascii, BinaryLittleEndian, BinaryBigEndian } format = Ascii;
+    QVector<PlyElement> elements;
+    qint64 size = 0; // bytes up to the data
+};
+
+bool readPlyHeader(const char* data, qint64 size, PlyHeader& header, QString* error)
+{
+    QByteArray text = QByteArray::fromRawData(data, int(qMin(size, qint64(1) << 20)));
+    int endHeader = text.indexOf("end_header");
+    if (!text.startsWith("ply") || endHeader < 0)
+        return fail(error, QStringLiteral("Not a PLY file"));
+    header.size = nextLine(data + endHeader, data + size) - data;
+    bool hasFormat = false;
+    for (const QByteArray& line : text.left(endHeader).split('\n')) {
+        QList<QByteArray> words = line.simplified().split(' ');
+        if (words[0] == "format" && words.size() >= 2) {
+            hasFormat = true;
+            if (words[1] == "ascii")
+                header.format = PlyHeader::Ascii;
+            else if (words[1] == "binary_little_endian")
+                header.format = PlyHeader::BinaryLittleEndian;
+            else if (words[1] == "binary_big_endian")
+                header.format = PlyHeader::BinaryBigEndian;
+            else
+                return fail(error, QStringLiteral("Unknown PLY format %1")
+                            .arg(QString(words[1])));
+        }
+        else if (words[0] == "element" && words.size() == 3) {
+            PlyElement element;
+            element.name = words[1];
+            element.count = words[2].toLongLong();
+            header.elements.push_back(element);
+        }
+        else if (words[0] == "property" && !header.elements.isEmpty()) {
+            PlyProperty property;
+            if (words.size() == 5 && words[1] == "list") {
+                property.countType = plyType(words[2]);
+                property.type = plyType(words[3]);
+            }
+            else if (words.size() == 3)
+                property.type = plyType(words[1]);
+            property.name = words.last();
+            if (property.type == Invalid
+             || (words[1] == "list" && property.countType == Invalid))
+                return fail(error, QStringLiteral("Bad PLY property: %1")
+                            .arg(QString(line)));
+            header.elements.last().properties.push_back(property);
+        }
+    }
+    if (!hasFormat)
+        return fail(error, QStringLiteral("PLY format is missing"));
+    return true;
+}
+
+const int* plyXyz(const PlyElement& vertex, int xyz[3])
+{
+    xyz[0] = vertex.indexOf("x");
+    xyz[1] = vertex.indexOf("y");
+    xyz[2] = vertex.indexOf("z");
+    return xyz[0] < 0 || xyz[1] < 0 || xyz[2] < 0 ? nullptr : xyz;
+}
+
+int plyIndexList(const PlyElement& face)
+{
+    int list = face.indexOf("vertex_indices");
+    if (list < 0)
+        list = face.indexOf("vertex_index");
+    return list >= 0 && face.properties[list].isList() ? list : -1;
+}
+
+bool readBinaryPly(const uchar* p, const uchar* end, const PlyHeader& header,
+                   Polyhedron& mesh, QString* error)
+{
+    const bool big = header.format == PlyHeader::BinaryBigEndian;
+    const QString truncated = QStringLiteral("PLY file is truncated");
+    for (const PlyElement& element : header.elements) {
+        if (element.name == "vertex") {
+            int xyz[3];
+            if (element.hasLists() || !plyXyz(element, xyz))
+                return fail(error, QStringLiteral("Unsupported PLY vertex layout"));
+            int record = 0, at[3];
+            for (int k = 0; k < element.properties.size(); k++) {
+                for (int c = 0; c < 3; c++)
+                    if (xyz[c] == k) at[c] = record;
+                record += plySize(element.properties[k].type);
+            }
+            if (element.count > INT_MAX)
+                return fail(error, QStringLiteral("Mesh is too large"));
+            if (element.count * record > end - p)
+                return fail(error, truncated);
+            mesh.points.resize(int(element.count));
+            float* out[3] = { mesh.points.x.data(), mesh.points.y.data(),
+                              mesh.points.z.data() };
+            PlyType type[3];
+            for (int c = 0; c < 3; c++)
+                type[c] = element.properties[xyz[c]].type;
+            parallelFor(int(element.count), [&](int begin, int last) {
+                for (int i = begin; i < last; i++)
+                    for (int c = 0; c < 3; c++)
+                        out[c][i] = float(plyRead(p + qint64(i) * record + at[c],
+                                                  type[c], big));
+            });
+            p += element.count * record;
+            continue;
+        }
+        int list = element.name == "face" ? plyIndexList(element) : -1;
+        if (element.name == "face" && list < 0)
+            return fail(error, QStringLiteral("PLY faces have no vertex indices"));
+        if (element.count >= INT_MAX)
+            return fail(error, QStringLiteral("Mesh is too large"));
+        // records have variable length: one sequential pass finds where
+        // every index list starts, then the lists are decoded in parallel
+        const uchar* base = p;
+        QVector<qint64> starts(list < 0 ? 0 : int(element.count));
+        if (list >= 0) {
+            mesh.offsets.resize(int(element.count) + 1);
+            mesh.offsets[0] = 0;
+        }
+        qint64 corners = 0;
+        for (int i = 0; i < element.count; i++) {
+            for (int k = 0; k < element.properties.size(); k++) {
+                const PlyProperty& property = element.properties[k];
+                if (!property.isList()) {
+                    if (end - p < plySize(property.type))
+                        return fail(error, truncated);
+                    p += plySize(property.type);
+                    continue;
+                }
+                if (end - p < plySize(property.countType))
+                    return fail(error, truncated);
+                qint64 n = qint64(plyRead(p, property.countType, big));
+                p += plySize(property.countType);
+                if (n < 0 || n * plySize(property.type) > end - p)
+                    return fail(error, truncated);
+                if (k == list) {
+                    starts[i] = p - base;
+                    corners += n;
+                    if (corners > INT_MAX)
+                        return fail(error, QStringLiteral("Mesh is too large"));
+                    mesh.offsets[i + 1] = int(corners);
+                }
+                p += n * plySize(property.type);
+            }
+        }
+        if (list < 0)
+            continue;
+        mesh.indices.resize(int(corners));
+        int* idx = mesh.indices.data();
+        const int* offsets = mesh.offsets.constData();
+        const PlyType type = element.properties[list].type;
+        const int step = plySize(type);
+        parallelFor(int(element.count), [&](int begin, int last) {
+            for (int i = begin; i < last; i++) {
+                const uchar* q = base + starts[i];
+                for (int k = offsets[i]; k < offsets[i + 1]; k++, q += step) {
+                    qint64 v = qint64(plyRead(q, type, big));
+                    idx[k] = v < 0 || v > INT_MAX ? -1 : int(v);
+                }
+            }
+        });
+    }
+    return true;
+}
+
+// Walks the properties of one face line; the index list is counted into n
+// and, when out is given, written there
+bool readPlyFaceLine(const char* p, const char* eol, const PlyElement& face,
+                     int list, qint64& n, int* out)
+{
+    n = 0;
+    for (int k = 0; k < face.properties.size(); k++) {
+        p = skipBlanks(p, eol);
+        if (!face.properties[k].isList()) {
+            if (p == eol) return false;
+            p = skipToken(p, eol);
+            continue;
+        }
+        qint64 count;
+        if (!(p = readInt(p, eol, count)) || count < 0)
+            return false;
+        for (qint64 j = 0; j < count; j++) {
+            p = skipBlanks(p, eol);
+            qint64 v;
+            if (k == list && out) {
+                if (!(p = readInt(p, eol, v)))
+                    return false;
+                out[j] = v < 0 || v > INT_MAX ? -1 : int(v);
+            }
+            else if (p == eol) return false;
+            else p = skipToken(p, eol);
+        }
+        if (k == list) n = count;
+    }
+    return true;
+}
+
+bool readAsciiPly(const char* p, const char* end, const PlyHeader& header,
+                  Polyhedron& mesh, QString* error)
+{
+    const QString truncated = QStringLiteral("PLY file is truncated");
+    const QString malformed = QStringLiteral("Malformed PLY data");
+    for (const PlyElement& element : header.elements) {
+        const char* last = skipLines(p, end, element.count);
+        if (!last)
+            return fail(error, truncated);
+        int list = element.name == "face" ? plyIndexList(element) : -1;
+        if (element.name != "vertex" && list < 0) {
+            if (element.name == "face")
+                return fail(error, QStringLiteral("PLY faces have no vertex indices"));
+            p = last;
+            continue;
+        }
+        if (element.count >= INT_MAX)
+            return fail(error, QStringLiteral("Mesh is too large"));
+
+        // first pass: lines and corners per chunk
+        QVector<const char*> cuts = splitLines(p, last, chunkCount(last - p));
+        int chunks = cuts.size() - 1;
+        QVector<qint64> lines(chunks + 1), corners(chunks + 1);
+        std::atomic<bool> ok(true);
+        parallelFor(chunks, [&](int begin, int stop) {
+            for (int c = begin; c < stop; c++)
+                for (const char* q = cuts[c]; q < cuts[c + 1]; q = nextLine(q, end)) {
+                    lines[c + 1]++;
+                    qint64 n;
+                    if (list >= 0 && !readPlyFaceLine(q, lineEnd(q, end), element,
+                                                      list, n, nullptr))
+                        ok = false;
+                    else if (list >= 0)
+                        corners[c + 1] += n;
+                }
+        }, 1);
+        std::partial_sum(lines.begin(), lines.end(), lines.begin());
+        std::partial_sum(corners.begin(), corners.end(), corners.begin());
+        if (!ok)
+            return fail(error, malformed);
+
+        // second pass: fill the arrays in place
+        if (element.name == "vertex") {
+            int xyz[3];
+            if (element.hasLists() || !plyXyz(element, xyz))
+                return fail(error, QStringLiteral("Unsupported PLY vertex layout"));
+            mesh.points.resize(int(element.count));
+            float* out[3] = { mesh.points.x.data(), mesh.points.y.data(),
+                              mesh.points.z.data() };
+            parallelFor(chunks, [&](int begin, int stop) {
+                for (int c = begin; c < stop; c++) {
+                    int i = int(lines[c]);
+                    for (const char* q = cuts[c]; q < cuts[c + 1];
+                         q = nextLine(q, end), i++) {
+                        const char* eol = lineEnd(q, end);
+                        for (int k = 0; k < element.properties.size(); k++) {
+                            q = skipBlanks(q, eol);
+                            int axis = k == xyz[0] ? 0 : k == xyz[1] ? 1 : k == xyz[2] ? 2 : -1;
+                            if (axis >= 0 && !(q = readFloat(q, eol, out[axis][i]))) {
+                                ok = false;
+                                return;
+                            }
+                            if (axis < 0) q = skipToken(q, eol);
+                        }
+                    }
+                }
+            }, 1);
+        }
+        else {
+            if (!allocate(mesh, mesh.vertexCount(), element.count, corners[chunks], error))
+                return false;
+            int* idx = mesh.indices.data();
+            int* offsets = mesh.offsets.data();
+            parallelFor(chunks, [&](int begin, int stop) {
+                for (int c = begin; c < stop; c++) {
+                    int f = int(lines[c]), corner = int(corners[c]);
+                    for (const char* q = cuts[c]; q < cuts[c + 1]; q = nextLine(q, end)) {
+                        qint64 n;
+                        if (!readPlyFaceLine(q, lineEnd(q, end), element, list, n,
+                                             idx + corner)) {
+                            ok = false;
+                            return;
+                        }
+                        corner += int(n);
+                        offsets[++f] = corner;
+                    }
+                }
+            }, 1);
+        }
+        if (!ok)
+            return fail(error, malformed);
+        p = last;
+    }
+    return true;
+}
+
+} // namespace
+
+bool importObj(const uchar* data, qint64 size, Polyhedron& mesh, QString* error)
+{
+    const char* begin = reinterpret_cast<const char*>(data);
+    const char* end = begin + size;
+    QVector<const char*> cuts = splitLines(begin, end, chunkCount(size));
+    int chunks = cuts.size() - 1;
+
+    // first pass: what every chunk holds, turned into where it starts
+    QVector<ObjChunk> counts(chunks + 1);
+    ObjChunk* c = counts.data();
+    parallelFor(chunks, [&](int first, int last) {
+        for (int k = first; k < last; k++)
+            countObj(cuts[k], cuts[k + 1], c[k + 1]);
+    }, 1);
+    for (int k = 1; k <= chunks; k++) {
+        c[k].vertices += c[k - 1].vertices;
+        c[k].polygons += c[k - 1].polygons;
+        c[k].corners  += c[k - 1].corners;
+    }
+    const ObjChunk& total = counts.last();
+    if (!allocate(mesh, total.vertices, total.polygons, total.corners, error))
+        return false;
+
+    // second pass: parse straight into the mesh arrays
+    std::atomic<bool> ok(true);
+    parallelFor(chunks, [&](int first, int last) {
+        for (int k = first; k < last; k++)
+            if (!parseObj(cuts[k], cuts[k + 1], c[k], int(total.vertices), mesh))
+                ok = false;
+    }, 1);
+    if (!ok)
+        return fail(error, QStringLiteral("Malformed OBJ data"));
+    weld(mesh);
+    return true;
+}
+
+bool importPly(const uchar* data, qint64 size, Polyhedron& mesh, QString* error)
+{
+    const char* text = reinterpret_cast<const char*>(data);
+    PlyHeader header;
+    if (!readPlyHeader(text, size, header, error))
+        return false;
+    bool ok = header.format == PlyHeader::Ascii
+            ? readAsciiPly(text + header.size, text + size, header, mesh, error)
+            : readBinaryPly(data + header.size, data + size, header, mesh, error);
+    if (!ok)
+        return false;
+    if (!indicesInRange(mesh))
+        return fail(error, QStringLiteral("PLY face refers to a missing vertex"));
+    dropDegenerate(mesh);
+    weld(mesh);
+    return true;
+}
+
+bool importStl(const uchar* data, qint64 size, Polyhedron& mesh, QString* error)
+{
+    if (size < 84)
+        return fail(error, QStringLiteral("STL file is truncated"));
+    qint64 triangles = qFromLittleEndian<quint32>(data + 80);
+    if (84 + 50 * triangles != size)
+        return fail(error, size >= 5 && !memcmp(data, "solid", 5)
+                    ? QStringLiteral("ASCII STL is not supported")
+                    : QStringLiteral("STL file is truncated"));
+    if (!allocate(mesh, 3 * triangles, triangles, 3 * triangles, error))
+        return false;
+
+    // every triangle gets its own three corners, welded afterwards
+    float *x = mesh.points.x.data(), *y = mesh.points.y.data(), *z = mesh.points.z.data();
+    int* idx = mesh.indices.data();
+    int* offsets = mesh.offsets.data();
+    parallelFor(int(triangles), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const uchar* corner = data + 84 + 50 * qint64(i) + 12;
+            for (int k = 3 * i; k < 3 * i + 3; k++, corner += 12) {
+                quint32 u[3];
+                for (int c = 0; c < 3; c++)
+                    u[c] = qFromLittleEndian<quint32>(corner + 4 * c);
+                memcpy(x + k, u + 0, 4);
+                memcpy(y + k, u + 1, 4);
+                memcpy(z + k, u + 2, 4);
+                idx[k] = k;
+            }
+            offsets[i + 1] = 3 * i + 3;
+        }
+    });
+    weld(mesh);
+    return true;
+}
+
+QVector<int> weldVertices(Coords& points)
+{
+    const int n = points.size();
+    const float *x = points.x.constData(), *y = points.y.constData(),
+                *z = points.z.constData();
+    // +0 and -0 are one position
+    auto bits = [](float f) {
+        f += 0.0f;
+        quint32 u;
+        memcpy(&u, &f, sizeof u);
+        return u;
+    };
+    auto same = [&](int i, int j) {
+        return bits(x[i]) == bits(x[j]) && bits(y[i]) == bits(y[j])
+            && bits(z[i]) == bits(z[j]);
+    };
+
+    QVector<quint32> hashes(n);
+    quint32* h = hashes.data();
+    parallelFor(n, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            quint32 k = bits(x[i]) * 0x9E3779B1u ^ bits(y[i]) * 0x85EBCA77u
+                      ^ bits(z[i]) * 0xC2B2AE3Du;
+            k ^= k >> 16; k *= 0x7FEB352Du;
+            k ^= k >> 15; k *= 0x846CA68Bu;
+            h[i] = k ^ k >> 16;
+        }
+    });
+
+    // Points are bucketed by the top hash bits so that every partition can
+    // be welded with its own table, without locks. The scatter keeps the
+    // points of a partition in input order.
+    const int parts = 256;
+    const int slices = qBound(1, n / 4096, threadCount() * 2);
+    auto sliceBegin = [&](int s) { return int(qint64(n) * s / slices); };
+    QVector<int> counts(slices * parts);
+    int* count = counts.data();
+    parallelFor(slices, [&](int first, int last) {
+        for (int s = first; s < last; s++)
+            for (int i = sliceBegin(s); i < sliceBegin(s + 1); i++)
+                count[s * parts + (h[i] >> 24)]++;
+    }, 1);
+    QVector<int> partBegin(parts + 1);
+    for (int p = 0, sum = 0; p < parts; p++) {
+        partBegin[p] = sum;
+        for (int s = 0; s < slices; s++) {
+            int c = counts[s * parts + p];
+            counts[s * parts + p] = sum;
+            sum += c;
+        }
+        partBegin[p + 1] = sum;
+    }
+    QVector<int> orders(n);
+    int* order = orders.data();
+    parallelFor(slices, [&](int first, int last) {
+        for (int s = first; s < last; s++)
+            for (int i = sliceBegin(s); i < sliceBegin(s + 1); i++)
+                order[count[s * parts + (h[i] >> 24)]++] = i;
+    }, 1);
+
+    // earliest point with the same position
+    QVector<int> remap(n);
+    int* firstSeen = remap.data();
+    parallelFor(parts, [&](int first, int last) {
+        QVector<int> table;
+        for (int p = first; p < last; p++) {
+            int size = 16;
+            while (size < 2 * (partBegin[p + 1] - partBegin[p]))
+                size *= 2;
+            table.fill(-1, size);
+            for (int k = partBegin[p]; k < partBegin[p + 1]; k++) {
+                int i = order[k];
+                int slot = h[i] & (size - 1);
+                while (table[slot] >= 0 && !same(table[slot], i))
+                    slot = (slot + 1) & (size - 1);
+                if (table[slot] < 0)
+                    table[slot] = i;
+                firstSeen[i] = table[slot];
+            }
+        }
+    }, 1);
+
+    // number the survivors in order; an earlier duplicate is always
+    // renumbered before the points that refer to it
+    Coords welded;
+    welded.reserve(n);
+    for (int i = 0; i < n; i++) {
+        if (firstSeen[i] == i) {
+            firstSeen[i] = welded.size();
+            welded.push_back({ x[i], y[i], z[i] });
+        }
+        else firstSeen[i] = firstSeen[firstSeen[i]];
+    }
+    welded.x.squeeze();
+    welded.y.squeeze();
+    welded.z.squeeze();
+    points = std::move(welded);
+    return remap;
+}
+
+bool importMesh(const QString& fileName, Polyhedron& mesh, QString* error)
+{
+    const QFileInfo source(fileName);
+    const QString cacheName = fileName + ".pmesh";
+    if (readMeshCache(cacheName, source, mesh))
+        return true;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(error, file.errorString());
+    const qint64 size = file.size();
+    uchar* data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data)
+        return fail(error, size > 0 ? file.errorString()
+                                    : QStringLiteral("File is empty"));
+    const QString suffix = source.suffix().toLower();
+    Polyhedron result;
+    bool ok = suffix == "obj" ? importObj(data, size, result, error)
+            : suffix == "ply" ? importPly(data, size, result, error)
+            : suffix == "stl" ? importStl(data, size, result, error)
+            : fail(error, QStringLiteral("Unknown mesh format: %1").arg(suffix));
+    file.unmap(data);
+    if (!ok)
+        return false;
+    if (result.polygonCount() == 0) {
+        result = convexHull(result.points);
+        if (result.polygonCount() == 0)
+            return fail(error, QStringLiteral("Points span no volume"));
+    }
+    result.fitTo(50);
+    result.reorderForLocality();
+    result.buildNormals(50 * 0.3);
+    result.randomizeColors();
+    result.buildAdjacency();
+    // a read-only directory just means no cache
+    writeMeshCache(cacheName, source, result);
+    mesh = result;
+    return true;
+}
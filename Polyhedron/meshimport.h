@@ -0,0 +1,27 @@
+#ifndef MESHIMPORT_H
+#define MESHIMPORT_H
+
+#include <QString>
+#include "polyhedron.h"
+
+// Reads a Wavefront OBJ, PLY (ASCII or binary) or binary STL file into
+// mesh, choosing the format by extension. The file is memory-mapped and
+// parsed in parallel chunks, duplicate vertices are welded, and the mesh
+// is fitted to the size of the generated figures and reordered for cache
+// locality. A file with vertices
+// but no faces is taken for a point cloud and gives its convex hull. The
+// result is cached next to the file as <fileName>.pmesh and taken from
+// there while the file's size and time stamp stay the same. Returns false
+// and sets error when the file cannot be read.
+bool importMesh(const QString& fileName, Polyhedron& mesh, QString* error = nullptr);
+
+// Parsers over an already mapped buffer; the mesh is left unfitted.
+bool importObj(const uchar* data, qint64 size, Polyhedron& mesh, QString* error);
+bool importPly(const uchar* data, qint64 size, Polyhedron& mesh, QString* error);
+bool importStl(const uchar* data, qint64 size, Polyhedron& mesh, QString* error);
+
+// Merges bit-identical positions into one vertex, numbering the survivors
+// in order of first appearance; returns the new index of every old one
+QVector<int> weldVertices(Coords& points);
+
+#endif // MESHIMPORT_H
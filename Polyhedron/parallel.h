@@ -0,0 +1,74 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <memory>
+#include <thread>
+#include <vector>
+
+inline int threadCount()
+{
+    return qMax(1, QThread::idealThreadCount());
+}
+
+// Calls f(begin, end) on contiguous slices of [0, n), one slice per thread.
+// Ranges shorter than two grains run on the calling thread.
+template <typename F>
+void parallelFor(int n, F f, int grain = 1 << 14)
+{
+    int threads = qMin(threadCount(), n / qMax(grain, 1));
+    if (threads <= 1) {
+        if (n > 0) f(0, n);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++)
+        pool.emplace_back(f, int(qint64(n) * t / threads),
+                             int(qint64(n) * (t + 1) / threads));
+    f(0, int(n / threads));
+    for (auto& thread : pool)
+        thread.join();
+}
+
+// Like parallelFor(), but on the threads of Qt's global pool, which stay
+// around from call to call: for the passes that run every frame, where
+// starting threads would cost about as much as the work. Slices no pool
+// thread has taken up by the time the calling thread is done with its own
+// are taken back and run there, so that a busy pool only makes it slower.
+template <typename F>
+void pooledFor(int n, F f, int grain = 1 << 14)
+{
+    int threads = qMin(threadCount(), n / qMax(grain, 1));
+    if (threads <= 1) {
+        if (n > 0) f(0, n);
+        return;
+    }
+    class Slice : public QRunnable
+    {
+    public:
+        Slice(F& f, int begin, int end, QSemaphore& done)
+            : f(f), begin(begin), end(end), done(done) { setAutoDelete(false); }
+        void run() override { f(begin, end); done.release(); }
+    private:
+        F& f;
+        int begin, end;
+        QSemaphore& done;
+    };
+    QThreadPool* pool = QThreadPool::globalInstance();
+    QSemaphore done;
+    std::vector<std::unique_ptr<Slice> > slices;
+    for (int t = 1; t < threads; t++) {
+        slices.emplace_back(new Slice(f, int(qint64(n) * t / threads),
+                                         int(qint64(n) * (t + 1) / threads), done));
+        pool->start(slices.back().get());
+    }
+    f(0, int(n / threads));
+    for (auto& slice : slices)
+        if (pool->tryTake(slice.get()))
+            slice->run();
+    done.acquire(threads - 1);
+}
+
+#endif // PARALLEL_H
@@ -3,44 +3,551 @@
 
 #include <QVector>
 #include <QVector3D>
-#include <QVector4D>
 #include <QColor>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include "parallel.h"
 
-struct Polygon;
+// Coordinates stored one array per axis, so that they can be transformed
+// several at a time
+struct Coords
+{
+    QVector<float> x, y, z;
+    int size() const { return x.size(); }
+    void resize(int n) { x.resize(n); y.resize(n); z.resize(n); }
+    void reserve(int n) { x.reserve(n); y.reserve(n); z.reserve(n); }
+    void clear() { x.clear(); y.clear(); z.clear(); }
+    void push_back(const QVector3D& v) {
+        x.push_back(v.x()); y.push_back(v.y()); z.push_back(v.z());
+    }
+    void set(int i, const QVector3D& v) {
+        x[i] = v.x(); y[i] = v.y(); z[i] = v.z();
+    }
+    QVector3D operator[](int i) const { return { x[i], y[i], z[i] }; }
+};
 
-struct Vertex
+struct Edge
 {
-    QVector<Polygon*> polygons;
-    QVector4D point_local;
-    QVector4D point_world;
-    Vertex() = default;
-    Vertex(int x, int y, int z) : point_local(x, y, z, 1) { }
+    int vertices[2];
+    int polygons[2]; // second is -1 on a boundary edge
 };
 
-struct Polygon
-{
-    QVector<Vertex*> vertices;
-    QVector4D normal_local;
-    QVector4D normal_world;
-    QColor color;
-    Polygon() = default;
-    Polygon(QVector<Vertex*> v) : vertices(v) { }
-    QVector4D mid() const {
-        return std::accumulate(vertices.begin(), vertices.end(), QVector4D(),
-            [](QVector4D s, Vertex* v){ return s += v->point_world;
-                }) / vertices.size();
-    }
+struct BvhNode
+{
+    float lower[3], upper[3];
+    int begin, end; // the node holds bvhPolygons[begin .. end)
+    int left;       // first child, the second one follows it; -1 for a leaf
+};
+
+// Where a ray meets the surface: the polygon, the distance along the ray
+// in lengths of its direction, and the barycentric weights u, v of
+// vs[corner - 1] and vs[corner] in the fan triangle vs[0], vs[corner - 1],
+// vs[corner] of the polygon's vertices vs
+struct RayHit
+{
+    int polygon = -1;
+    int corner = 0;
+    float t = 0;
+    float u = 0, v = 0;
 };
 
 struct Polyhedron
 {
-    QVector<Vertex> vertices;
-    QVector<Polygon> polygons;
+    Coords points;                 // vertex positions
+    Coords normals;                // polygon normals
+    QVector<int> indices;          // vertices of all polygons, one after another
+    QVector<int> offsets = { 0 };  // polygon i is indices[offsets[i] .. offsets[i+1])
+    QVector<QRgb> colors;
+    QVector<int> vertexPolygons;   // polygons around vertex v are
+    QVector<int> vertexOffsets;    // vertexPolygons[vertexOffsets[v] .. vertexOffsets[v+1])
+    QVector<int> twins;            // half-edge h runs from corner h to the next
+    QVector<int> halfEdgePolygons; // corner of polygon halfEdgePolygons[h], and
+                                   // twins[h] back along it, -1 on a boundary
+    QVector<Edge> edges;
+    QVector<BvhNode> bvh;          // root first
+    QVector<int> bvhPolygons;      // polygons in leaf order
+
+    int vertexCount() const { return points.size(); }
+    int polygonCount() const { return offsets.size() - 1; }
+    int polygonSize(int i) const { return offsets[i + 1] - offsets[i]; }
+    const int* polygon(int i) const { return indices.constData() + offsets[i]; }
+    int next(int h) const
+    { return h + 1 < offsets[halfEdgePolygons[h] + 1] ? h + 1 : offsets[halfEdgePolygons[h]]; }
+    int origin(int h) const { return indices[h]; }
+    int target(int h) const { return indices[next(h)]; }
+    QVector3D mid(int i, const Coords& at) const;
+    void bounds(QVector3D& lower, QVector3D& upper) const;
+
+    int addVertex(const QVector3D& p);
+    void addPolygon(const QVector<int>& vs);
+    void buildNormals(float length);
+    void fitTo(float halfSize);
+    void reorderForLocality();
+    void randomizeColors();
+    void buildAdjacency();
+    void buildHalfEdges();
+    void buildEdges();
+    void buildBvh();
+    bool intersect(const QVector3D& origin, const QVector3D& direction, RayHit& hit,
+                   float tMin = 0,
+                   float tMax = std::numeric_limits<float>::max()) const;
+    int nearestVertex(const RayHit& hit) const;
 
     static Polyhedron GenerateCube();
     static Polyhedron GeneratePyramid();
+
+    // generators.cpp; every level has four times the polygons of the one
+    // before it
+    static Polyhedron GenerateGeodesicSphere(int level);
+    static Polyhedron GenerateTorus(int level);
+    static Polyhedron GenerateSuperquadric(int level, float e1 = 0.3f, float e2 = 0.3f);
+    Polyhedron subdividedCatmullClark(int levels) const;
+    Polyhedron subdividedLoop(int levels) const;
 };
 
+// centroid of polygon i, taking vertex positions from the given coordinates
+inline QVector3D Polyhedron::mid(int i, const Coords& at) const
+{
+    const int* vs = polygon(i);
+    QVector3D s;
+    for (int j = 0; j < polygonSize(i); j++)
+        s += at[vs[j]];
+    return s / polygonSize(i);
+}
+
+inline void Polyhedron::bounds(QVector3D& lower, QVector3D& upper) const
+{
+    lower = upper = points.size() ? points[0] : QVector3D();
+    for (int i = 1; i < points.size(); i++) {
+        QVector3D p = points[i];
+        for (int c = 0; c < 3; c++) {
+            lower[c] = qMin(lower[c], p[c]);
+            upper[c] = qMax(upper[c], p[c]);
+        }
+    }
+}
+
+inline int Polyhedron::addVertex(const QVector3D& p)
+{
+    points.push_back(p);
+    return points.size() - 1;
+}
+
+inline void Polyhedron::addPolygon(const QVector<int>& vs)
+{
+    indices.append(vs);
+    offsets.push_back(indices.size());
+    colors.push_back(rand());
+}
+
+// Newell's method, scaled to the given length
+inline void Polyhedron::buildNormals(float length)
+{
+    normals.resize(polygonCount());
+    float *nx = normals.x.data(), *ny = normals.y.data(), *nz = normals.z.data();
+    parallelFor(polygonCount(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const int* vs = polygon(i);
+            QVector3D n;
+            for (int j = 0, k = polygonSize(i) - 1; j < polygonSize(i); k = j++) {
+                QVector3D a = points[vs[k]], b = points[vs[j]];
+                n += QVector3D((a.y() - b.y()) * (a.z() + b.z()),
+                               (a.z() - b.z()) * (a.x() + b.x()),
+                               (a.x() - b.x()) * (a.y() + b.y()));
+            }
+            n = n.normalized() * length;
+            nx[i] = n.x(); ny[i] = n.y(); nz[i] = n.z();
+        }
+    });
+}
+
+// centers the bounding box at the origin and scales the largest half
+// extent to halfSize
+inline void Polyhedron::fitTo(float halfSize)
+{
+    QVector3D lo, hi;
+    bounds(lo, hi);
+    QVector3D center = (lo + hi) / 2, half = (hi - lo) / 2;
+    float extent = qMax(half.x(), qMax(half.y(), half.z()));
+    float k = extent > 0 ? halfSize / extent : 1;
+    float *x = points.x.data(), *y = points.y.data(), *z = points.z.data();
+    parallelFor(points.size(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            x[i] = (x[i] - center.x()) * k;
+            y[i] = (y[i] - center.y()) * k;
+            z[i] = (z[i] - center.z()) * k;
+        }
+    });
+}
+
+// Sorts the polygons along a Morton curve through their centroids and
+// numbers the vertices in the order the sorted polygons first use them,
+// so that polygons close in space are close in memory and so are the
+// points they read. Meant for freshly loaded meshes: normals and colors
+// follow their polygons, everything built from the indices is dropped.
+inline void Polyhedron::reorderForLocality()
+{
+    const int n = polygonCount();
+    if (n == 0)
+        return;
+    QVector3D lower, upper;
+    bounds(lower, upper);
+    const QVector3D extent = upper - lower;
+    const float cells = 1023;
+    float scale[3];
+    for (int c = 0; c < 3; c++)
+        scale[c] = extent[c] > 0 ? cells / extent[c] : 0;
+    // ten bits of every coordinate, interleaved
+    auto spread = [](quint32 v) {
+        v = (v | v << 16) & 0x030000FFu;
+        v = (v | v << 8)  & 0x0300F00Fu;
+        v = (v | v << 4)  & 0x030C30C3u;
+        v = (v | v << 2)  & 0x09249249u;
+        return v;
+    };
+    QVector<quint64> keys(n);
+    parallelFor(n, [&, key = keys.data()](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            QVector3D m = mid(i, points) - lower;
+            quint32 code = 0;
+            for (int c = 0; c < 3; c++)
+                code |= spread(quint32(qBound(0.0f, m[c] * scale[c], cells))) << c;
+            key[i] = quint64(code) << 32 | quint32(i);
+        }
+    });
+    // radix sort, ten bits of the code at a time; the index below them
+    // keeps the order stable
+    QVector<quint64> sorted(n);
+    for (int shift = 32; shift < 62; shift += 10) {
+        QVector<int> first(1024 + 1, 0);
+        for (quint64 k : qAsConst(keys))
+            first[(k >> shift & 1023) + 1]++;
+        std::partial_sum(first.begin(), first.end(), first.begin());
+        for (quint64 k : qAsConst(keys))
+            sorted[first[k >> shift & 1023]++] = k;
+        keys.swap(sorted);
+    }
+    const quint64* key = keys.constData();
+
+    QVector<int> newIndices(indices.size()), newOffsets(n + 1);
+    QVector<int> remap(vertexCount(), -1);
+    Coords newPoints;
+    newPoints.reserve(vertexCount());
+    newOffsets[0] = 0;
+    for (int k = 0; k < n; k++) {
+        const int i = int(quint32(key[k]));
+        int at = newOffsets[k];
+        for (int j = offsets[i]; j < offsets[i + 1]; j++) {
+            int& v = remap[indices[j]];
+            if (v < 0) {
+                v = newPoints.size();
+                newPoints.push_back(points[indices[j]]);
+            }
+            newIndices[at++] = v;
+        }
+        newOffsets[k + 1] = at;
+    }
+    // vertices of no polygon keep their order, after the rest
+    for (int v = 0; v < vertexCount(); v++)
+        if (remap[v] < 0)
+            newPoints.push_back(points[v]);
+    if (normals.size() == n) {
+        const Coords old = normals;
+        for (int k = 0; k < n; k++)
+            normals.set(k, old[int(quint32(key[k]))]);
+    }
+    if (colors.size() == n) {
+        const QVector<QRgb> old = colors;
+        for (int k = 0; k < n; k++)
+            colors[k] = old[int(quint32(key[k]))];
+    }
+    points = std::move(newPoints);
+    indices = std::move(newIndices);
+    offsets = std::move(newOffsets);
+    vertexPolygons.clear();
+    vertexOffsets.clear();
+    twins.clear();
+    halfEdgePolygons.clear();
+    edges.clear();
+    bvh.clear();
+    bvhPolygons.clear();
+}
+
+// pseudo-random colors derived from the polygon number
+inline void Polyhedron::randomizeColors()
+{
+    colors.resize(polygonCount());
+    QRgb* c = colors.data();
+    parallelFor(polygonCount(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            quint32 h = quint32(i) * 0x9E3779B1u;
+            h ^= h >> 15; h *= 0x2C1B3C6Du;
+            c[i] = h ^ h >> 12;
+        }
+    });
+}
+
+inline void Polyhedron::buildAdjacency()
+{
+    vertexOffsets.fill(0, vertexCount() + 1);
+    for (int v : qAsConst(indices))
+        vertexOffsets[v + 1]++;
+    std::partial_sum(vertexOffsets.begin(), vertexOffsets.end(),
+                     vertexOffsets.begin());
+    vertexPolygons.resize(indices.size());
+    QVector<int> fill = vertexOffsets;
+    for (int i = 0; i < polygonCount(); i++)
+        for (int j = offsets[i]; j < offsets[i + 1]; j++)
+            vertexPolygons[fill[indices[j]]++] = i;
+}
+
+// Every edge is hashed to the bucket of its lower end. A counting sort
+// lays the buckets out one after another, like the polygons around the
+// vertices in buildAdjacency(), and the few half-edges in a bucket are
+// paired off among themselves, so the work is linear in the corners. An
+// edge of more than two polygons pairs the first two and leaves the rest
+// on the boundary.
+inline void Polyhedron::buildHalfEdges()
+{
+    const int n = indices.size();
+    halfEdgePolygons.resize(n);
+    int* polygonOf = halfEdgePolygons.data();
+    parallelFor(polygonCount(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            std::fill(polygonOf + offsets[i], polygonOf + offsets[i + 1], i);
+    });
+
+    // half-edge k of polygon i ends at corner h
+    auto forEachHalfEdge = [&](auto f) {
+        for (int i = 0; i < polygonCount(); i++)
+            for (int h = offsets[i], k = offsets[i + 1] - 1; h < offsets[i + 1]; k = h++)
+                f(k, indices[k], indices[h]);
+    };
+    QVector<int> first(vertexCount() + 2, 0);
+    forEachHalfEdge([&](int, int a, int b) { first[qMin(a, b) + 2]++; });
+    std::partial_sum(first.begin(), first.end(), first.begin());
+    struct Entry { int upper, halfEdge; };
+    QVector<Entry> buckets(n);
+    forEachHalfEdge([&](int k, int a, int b) {
+        buckets[first[qMin(a, b) + 1]++] = { qMax(a, b), k };
+    });
+
+    twins.fill(-1, n);
+    int* twin = twins.data();
+    const Entry* entries = buckets.constData();
+    parallelFor(vertexCount(), [&](int begin, int end) {
+        for (int v = begin; v < end; v++)
+            for (int x = first[v]; x < first[v + 1]; x++) {
+                if (twin[entries[x].halfEdge] >= 0)
+                    continue;
+                for (int y = x + 1; y < first[v + 1]; y++)
+                    if (entries[y].upper == entries[x].upper
+                            && twin[entries[y].halfEdge] < 0) {
+                        twin[entries[x].halfEdge] = entries[y].halfEdge;
+                        twin[entries[y].halfEdge] = entries[x].halfEdge;
+                        break;
+                    }
+            }
+    });
+}
+
+// one edge for the first half-edge of every pair and for every one on
+// the boundary
+inline void Polyhedron::buildEdges()
+{
+    if (twins.size() != indices.size())
+        buildHalfEdges();
+    edges.clear();
+    edges.reserve(indices.size() / 2);
+    for (int h = 0; h < indices.size(); h++) {
+        const int t = twins[h];
+        if (t < 0)
+            edges.push_back({ { origin(h), target(h) }, { halfEdgePolygons[h], -1 } });
+        else if (h < t)
+            edges.push_back({ { origin(h), target(h) },
+                              { halfEdgePolygons[h], halfEdgePolygons[t] } });
+    }
+}
+
+// Bounding volume hierarchy over the polygons, split at the median of
+// the centroids along their longest extent
+inline void Polyhedron::buildBvh()
+{
+    const int leafSize = 4;
+    const int n = polygonCount();
+    bvh.clear();
+    bvhPolygons.resize(n);
+    std::iota(bvhPolygons.begin(), bvhPolygons.end(), 0);
+    if (n == 0)
+        return;
+
+    Coords lo, hi, center;
+    lo.resize(n); hi.resize(n); center.resize(n);
+    float* box[3][3] = {
+        { lo.x.data(), lo.y.data(), lo.z.data() },
+        { hi.x.data(), hi.y.data(), hi.z.data() },
+        { center.x.data(), center.y.data(), center.z.data() },
+    };
+    parallelFor(n, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const int* vs = polygon(i);
+            QVector3D l = points[vs[0]], h = l, s;
+            for (int j = 0; j < polygonSize(i); j++) {
+                QVector3D p = points[vs[j]];
+                for (int c = 0; c < 3; c++) {
+                    l[c] = qMin(l[c], p[c]);
+                    h[c] = qMax(h[c], p[c]);
+                }
+                s += p;
+            }
+            s /= polygonSize(i);
+            for (int c = 0; c < 3; c++) {
+                box[0][c][i] = l[c];
+                box[1][c][i] = h[c];
+                box[2][c][i] = s[c];
+            }
+        }
+    });
+
+    struct Range { int node, begin, end; };
+    QVector<Range> stack = { { 0, 0, n } };
+    bvh.reserve(2 * n / leafSize + 1);
+    bvh.resize(1);
+    int* order = bvhPolygons.data();
+    while (!stack.isEmpty()) {
+        Range r = stack.takeLast();
+        BvhNode node = { { 0, 0, 0 }, { 0, 0, 0 }, r.begin, r.end, -1 };
+        float cl[3], ch[3];
+        for (int c = 0; c < 3; c++) {
+            node.lower[c] = cl[c] = std::numeric_limits<float>::max();
+            node.upper[c] = ch[c] = std::numeric_limits<float>::lowest();
+        }
+        for (int k = r.begin; k < r.end; k++) {
+            int i = order[k];
+            for (int c = 0; c < 3; c++) {
+                node.lower[c] = qMin(node.lower[c], box[0][c][i]);
+                node.upper[c] = qMax(node.upper[c], box[1][c][i]);
+                cl[c] = qMin(cl[c], box[2][c][i]);
+                ch[c] = qMax(ch[c], box[2][c][i]);
+            }
+        }
+        int axis = 0;
+        for (int c = 1; c < 3; c++)
+            if (ch[c] - cl[c] > ch[axis] - cl[axis])
+                axis = c;
+        if (r.end - r.begin > leafSize && ch[axis] > cl[axis]) {
+            int mid = (r.begin + r.end) / 2;
+            const float* key = box[2][axis];
+            std::nth_element(order + r.begin, order + mid, order + r.end,
+                             [key](int a, int b) { return key[a] < key[b]; });
+            node.left = bvh.size();
+            bvh.resize(bvh.size() + 2);
+            stack.push_back({ node.left, r.begin, mid });
+            stack.push_back({ node.left + 1, mid, r.end });
+        }
+        bvh[r.node] = node;
+    }
+}
+
+// Nearest hit of the ray origin + t * direction with t in [tMin, tMax],
+// walking the BVH nearer child first and skipping boxes beyond the best
+// hit so far. Faces are hit from either side.
+inline bool Polyhedron::intersect(const QVector3D& origin, const QVector3D& direction,
+                                  RayHit& hit, float tMin, float tMax) const
+{
+    hit = RayHit();
+    if (bvh.isEmpty())
+        return false;
+    float inverse[3];
+    for (int c = 0; c < 3; c++)
+        inverse[c] = 1 / direction[c];
+    // whether the ray meets the node's box before the best hit so far,
+    // and where it enters it
+    auto enter = [&](const BvhNode& node, float& t) {
+        float t0 = tMin, t1 = tMax;
+        for (int c = 0; c < 3; c++) {
+            float a = (node.lower[c] - origin[c]) * inverse[c];
+            float b = (node.upper[c] - origin[c]) * inverse[c];
+            if (a > b)
+                std::swap(a, b);
+            // NaN from 0 * inf keeps the bound
+            t0 = a > t0 ? a : t0;
+            t1 = b < t1 ? b : t1;
+        }
+        t = t0;
+        return t0 <= t1;
+    };
+
+    struct Entry { int node; float t; };
+    Entry stack[64];
+    int depth = 0;
+    if (!enter(bvh[0], stack[0].t))
+        return false;
+    stack[depth++].node = 0;
+    while (depth > 0) {
+        Entry entry = stack[--depth];
+        if (entry.t > tMax)
+            continue;
+        const BvhNode& node = bvh[entry.node];
+        if (node.left >= 0) {
+            Entry first = { node.left, 0 }, second = { node.left + 1, 0 };
+            bool isFirst = enter(bvh[first.node], first.t);
+            bool isSecond = enter(bvh[second.node], second.t);
+            if (isFirst && isSecond && second.t < first.t)
+                std::swap(first, second);
+            if (isSecond && depth < 64)
+                stack[depth++] = second;
+            if (isFirst && depth < 64)
+                stack[depth++] = first;
+            continue;
+        }
+        for (int k = node.begin; k < node.end; k++) {
+            int i = bvhPolygons[k];
+            const int* vs = polygon(i);
+            QVector3D a = points[vs[0]];
+            for (int j = 2; j < polygonSize(i); j++) {
+                // Moller-Trumbore
+                QVector3D e1 = points[vs[j - 1]] - a, e2 = points[vs[j]] - a;
+                QVector3D p = QVector3D::crossProduct(direction, e2);
+                float det = QVector3D::dotProduct(e1, p);
+                if (qAbs(det) < 1e-12f)
+                    continue;
+                QVector3D s = origin - a;
+                float u = QVector3D::dotProduct(s, p) / det;
+                if (u < 0 || u > 1)
+                    continue;
+                QVector3D q = QVector3D::crossProduct(s, e1);
+                float v = QVector3D::dotProduct(direction, q) / det;
+                if (v < 0 || u + v > 1)
+                    continue;
+                float t = QVector3D::dotProduct(e2, q) / det;
+                if (t < tMin || t > tMax)
+                    continue;
+                tMax = t;
+                hit.polygon = i;
+                hit.corner = j;
+                hit.t = t;
+                hit.u = u;
+                hit.v = v;
+            }
+        }
+    }
+    return hit.polygon >= 0;
+}
+
+// the vertex of the hit triangle closest to the hit
+inline int Polyhedron::nearestVertex(const RayHit& hit) const
+{
+    if (hit.polygon < 0)
+        return -1;
+    const int* vs = polygon(hit.polygon);
+    float w = 1 - hit.u - hit.v;
+    if (w >= hit.u && w >= hit.v)
+        return vs[0];
+    return hit.u >= hit.v ? vs[hit.corner - 1] : vs[hit.corner];
+}
+
 inline Polyhedron Polyhedron::GenerateCube()
 {
     const int L = 50;
@@ -48,7 +555,7 @@ inline Polyhedron Polyhedron::GenerateCube()
     for (int x : {-L, L})
         for (int y : {-L, L})
             for (int z : {-L, L})
-                cube.vertices.push_back({x, y, z});
+                cube.addVertex(QVector3D(x, y, z));
     QVector<QVector<int> > planes = {
         { 0, 1, 3, 2 },
         { 0, 2, 6, 4 },
@@ -57,20 +564,10 @@ inline Polyhedron Polyhedron::GenerateCube()
         { 2, 3, 7, 6 },
         { 4, 6, 7, 5 },
     };
-    cube.polygons.resize(planes.size());
-    for (int i = 0; i < planes.size(); i++) {
-        for (int p : planes[i]) {
-            cube.polygons[i].vertices.push_back(&cube.vertices[p]);
-            cube.vertices[p].polygons.push_back(&cube.polygons[i]);
-        }
-        cube.polygons[i].normal_local = QVector3D::normal(
-            cube.polygons[i].vertices[0]->point_local.toVector3D(),
-            cube.polygons[i].vertices[1]->point_local.toVector3D(),
-            cube.polygons[i].vertices[2]->point_local.toVector3D()
-        ) * L * 0.3;
-        cube.polygons[i].normal_local.setW(0);
-        cube.polygons[i].color = rand();
-    }
+    for (const auto& plane : planes)
+        cube.addPolygon(plane);
+    cube.buildNormals(L * 0.3);
+    cube.buildAdjacency();
     return cube;
 }
 
@@ -80,8 +577,8 @@ inline Polyhedron Polyhedron::GeneratePyramid()
     Polyhedron pyramid;
     for (int x : {-L, L})
         for (int z : {-L, L})
-                pyramid.vertices.push_back({x, 0, z});
-    pyramid.vertices.push_back({0, -3*L, 0});
+                pyramid.addVertex(QVector3D(x, 0, z));
+    pyramid.addVertex(QVector3D(0, -3*L, 0));
     QVector<QVector<int> > planes = {
         { 0, 1, 3, 2 },
         { 0, 2, 4 },
@@ -89,20 +586,10 @@ inline Polyhedron Polyhedron::GeneratePyramid()
         { 1, 4, 3 },
         { 2, 3, 4 }
     };
-    pyramid.polygons.resize(planes.size());
-    for (int i = 0; i < planes.size(); i++) {
-        for (int p : planes[i]) {
-            pyramid.polygons[i].vertices.push_back(&pyramid.vertices[p]);
-            pyramid.vertices[p].polygons.push_back(&pyramid.polygons[i]);
-        }
-        pyramid.polygons[i].normal_local = QVector3D::normal(
-            pyramid.polygons[i].vertices[0]->point_local.toVector3D(),
-            pyramid.polygons[i].vertices[1]->point_local.toVector3D(),
-            pyramid.polygons[i].vertices[2]->point_local.toVector3D()
-        ) * L * 0.3;
-        pyramid.polygons[i].normal_local.setW(0);
-        pyramid.polygons[i].color = rand();
-    }
+    for (const auto& plane : planes)
+        pyramid.addPolygon(plane);
+    pyramid.buildNormals(L * 0.3);
+    pyramid.buildAdjacency();
     return pyramid;
 }
 
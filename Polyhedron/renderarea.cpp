@@ -5,24 +5,72 @@ const QMatrix4x4 RenderArea::viewTop   = { 1,0,0,0, 0,0,0,0, 0,0,1,0, 0,0,0,1 };
 const QMatrix4x4 RenderArea::viewFront = { 1,0,0,0, 0,1,0,0, 0,0,0,0, 0,0,0,1 };
 const QMatrix4x4 RenderArea::viewOrtho = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
 
+namespace {
+
+// A box is out of the view if all its corners are beyond one plane, and
+// in if none is beyond any: the codes all corners of the box transformed
+// by m share, and in anyCodes those that any of them has
+int boxOutcodes(const BvhNode& box, const QMatrix4x4& m, const Frustum& frustum,
+                int& anyCodes)
+{
+    int allCodes = ClipAll;
+    anyCodes = 0;
+    for (int k = 0; k < 8; k++) {
+        QVector3D p = m * QVector3D(k & 1 ? box.upper[0] : box.lower[0],
+                                    k & 2 ? box.upper[1] : box.lower[1],
+                                    k & 4 ? box.upper[2] : box.lower[2]);
+        int code = frustum.outcode(frustum.toClip(p.x(), p.y(), p.z())) & ClipAll;
+        allCodes &= code;
+        anyCodes |= code;
+    }
+    return allCodes;
+}
+
+} // namespace
+
 RenderArea::RenderArea(QWidget *parent)
     : QWidget(parent)
-    , faceVariant(NONE)
-    , isDrawingWireframe(true)
-    , isDrawingNormals(false)
-    , isNormalMethodEnabled(true)
-    , isZSortingEnabled(false)
+    , level(0)
+    , dirty(0)
+    , front(0)
+    , isRendering(false)
+    , selectedPolygon(-1)
+    , selectedVertex(-1)
+    , selectedView(0)
 {
+    renderContext.moveToThread(&renderThread);
+    renderThread.start();
+    levelContext.moveToThread(&levelThread);
+    levelThread.start();
     QWidget::resize(parent->size());
     update();
 }
 
+// waits for the frame being drawn and the levels being built, if any
+RenderArea::~RenderArea()
+{
+    figureGeneration.fetchAndAddOrdered(1);
+    levelThread.quit();
+    levelThread.wait();
+    renderThread.quit();
+    renderThread.wait();
+}
+
 void RenderArea::update()
 {
-    point_WorldTrans = shift * rotate.transposed() * scale * point_viewport;
-    vector_WorldTrans = NormalVecTransf(point_WorldTrans);
+    settings.rotate = rotate;
+    settings.point_PoseTrans = shift * rotate.transposed() * scale;
+    settings.point_viewport = point_viewport;
+    settings.point_WorldTrans = settings.point_PoseTrans * point_viewport;
+    settings.vector_WorldTrans = NormalVecTransf(settings.point_WorldTrans);
+    invalidate(MatricesDirty);
+    emit debug(settings.point_WorldTrans);
+}
+
+void RenderArea::invalidate(uint flags)
+{
+    settings.dirty |= flags;
     QWidget::update();
-    emit debug(point_WorldTrans);
 }
 
 const QPoint RenderArea::getCenter() const
@@ -30,22 +78,83 @@ const QPoint RenderArea::getCenter() const
     return { width() / 2, height() / 2 };
 }
 
+// Painting only shows the last finished frame, with the selection over
+// it, and starts the next one when something other than the selection
+// changed since
 void RenderArea::paintEvent(QPaintEvent*)
 {
+    const Frame& shown = frames[front];
+    if (shown.image.size() != size() * devicePixelRatioF())
+        settings.dirty |= VisualDirty;
+    if (settings.dirty)
+        startFrame();
+    QPainter painter(this);
+    painter.drawImage(0, 0, shown.image);
+    paintSelection(painter);
+}
+
+// The render thread draws the frame into the image that is not on screen,
+// from a copy of the settings as they are now. Changes made meanwhile
+// gather until it is done, so however long a frame takes, the widget
+// never waits for it and is never more than one frame behind.
+void RenderArea::startFrame()
+{
+    if (isRendering)
+        return;
+    isRendering = true;
+    settings.size = size();
+    settings.pixelRatio = devicePixelRatioF();
+    const Settings next = settings;
+    settings.dirty = 0;
+    const int back = 1 - front;
+    QMetaObject::invokeMethod(&renderContext, [this, next, back]() {
+        current = next;
+        renderFrame(frames[back]);
+        QMetaObject::invokeMethod(this, [this, back]() { showFrame(back); },
+                                  Qt::QueuedConnection);
+    });
+}
+
+// back on the widget's thread with the finished frame
+void RenderArea::showFrame(int finished)
+{
+    const int shownLevel = frames[front].level;
+    front = finished;
+    isRendering = false;
+    if (frames[front].level != shownLevel)
+        clearSelection();
+#ifndef POLYHEDRON_NO_STATS
+    emit statsChanged(frames[front].stats);
+#endif
+    QWidget::update();
+}
+
+void RenderArea::renderFrame(Frame& frame)
+{
+    stats = RenderStats();
+    STATS_TIMER(frameTimer);
+    dirty |= current.dirty;
+    const QSize pixels = current.size * current.pixelRatio;
+    if (frame.image.size() != pixels) {
+        frame.image = QImage(pixels, QImage::Format_ARGB32_Premultiplied);
+        frame.image.setDevicePixelRatio(current.pixelRatio);
+    }
+    frame.image.fill(Qt::transparent);
+    const int width = current.size.width(), height = current.size.height();
     QPainter painter;
-    painter.begin(this);
+    painter.begin(&frame.image);
     painter.setRenderHints(QPainter::Antialiasing);
     painter.setPen(Qt::GlobalColor::gray);
-    painter.drawRect(0, 0, width()-1, height()-1);
+    painter.drawRect(0, 0, width-1, height-1);
 
     // plot axes
     painter.translate(60, 60);
     painter.setBrush(QBrush(Qt::GlobalColor::gray,
                             Qt::BrushStyle::Dense7Pattern));
     painter.drawEllipse({0, 0}, 55, 55);
-    QPoint Ax = (rotate * QVector3D(50, 0, 0)).toPoint();
-    QPoint Ay = (rotate * QVector3D(0, 50, 0)).toPoint();
-    QPoint Az = (rotate * QVector3D(0, 0, 50)).toPoint();
+    QPoint Ax = (current.rotate * QVector3D(50, 0, 0)).toPoint();
+    QPoint Ay = (current.rotate * QVector3D(0, 50, 0)).toPoint();
+    QPoint Az = (current.rotate * QVector3D(0, 0, 50)).toPoint();
     painter.setPen(Qt::GlobalColor::red);
     painter.drawLine(QPoint(0, 0), Ax);
     painter.drawText(Ax, "X");
@@ -57,53 +166,886 @@ void RenderArea::paintEvent(QPaintEvent*)
     painter.drawText(Az, "Z");
     painter.translate(-60, -60);
 
-    // to screen space
-    painter.translate(getCenter());
-
-    // transform figure
-    for (auto& v : figure.vertices)
-        v.point_world = point_WorldTrans * v.point_local;
-    for (auto& p : figure.polygons)
-        p.normal_world = vector_WorldTrans * p.normal_local;
-
-    QVector<Polygon> tmpPolygons;
-    if (isZSortingEnabled) {
-        tmpPolygons = figure.polygons;
-        std::sort(figure.polygons.begin(), figure.polygons.end(),
-                  [&](const Polygon& lhs, const Polygon& rhs) {
-            if (!qFuzzyCompare(lhs.mid().z(), rhs.mid().z()))
-                return lhs.mid().z() > rhs.mid().z();
-            return lhs.normal_world.z() > rhs.normal_world.z();
-        });
+    // geometry is culled and retransformed only when the view or the
+    // figure changed
+    if (dirty & FigureDirty) {
+        level = 0;
+        figure = current.scene.isEmpty() && !current.levels.isEmpty()
+               ? current.levels[level] : Polyhedron();
+    }
+    if (dirty & (MatricesDirty | FigureDirty)) {
+        STATS_TIMER(transformTimer);
+        layoutViews();
+        if (current.scene.isEmpty()) {
+            selectLevel();
+            transformFigure();
+            for (View& view : views)
+                projectFigure(view);
+        }
+        else
+            for (View& view : views)
+                transformScene(view);
+        STATS_TIME(stats, transformNs, transformTimer);
+        STATS_ADD(stats, transformNs, -stats.cullNs);
+        dirty |= OrderDirty | LinesDirty;
+    }
+    if (dirty & OrderDirty) {
+        STATS_TIMER(sortTimer);
+        for (View& view : views)
+            sortPolygons(view);
+        STATS_TIME(stats, sortNs, sortTimer);
+    }
+    // hidden lines wait for the next frame that shows them; they are
+    // only found for a single figure
+    bool isHidingEdges = current.isDrawingWireframe && current.isHidingLines
+                      && current.scene.isEmpty();
+    if (isHidingEdges && (dirty & LinesDirty)) {
+        for (View& view : views)
+            findHiddenLines(view);
+        dirty &= ~LinesDirty;
+    }
+    dirty &= LinesDirty;
+
+    // to screen space of every view
+    STATS_TIMER(drawTimer);
+    for (const View& view : qAsConst(views)) {
+        painter.save();
+        if (current.isQuadView)
+            painter.setClipRect(view.rect);
+        painter.translate(view.center());
+        paintView(painter, frame.image, view, isHidingEdges);
+        painter.restore();
+    }
+    if (current.isQuadView) {
+        painter.setPen(Qt::GlobalColor::gray);
+        painter.drawLine(QPoint(width / 2, 0), QPoint(width / 2, height));
+        painter.drawLine(QPoint(0, height / 2), QPoint(width, height / 2));
+        for (const View& view : qAsConst(views))
+            painter.drawText(QPoint(view.rect.left() + 6, view.rect.bottom() - 6),
+                             view.title);
+    }
+    STATS_TIME(stats, drawNs, drawTimer);
+    STATS_TIME(stats, frameNs, frameTimer);
+#ifndef POLYHEDRON_NO_STATS
+    if (current.isShowingStats)
+        paintStats(painter);
+#endif
+    painter.end();
+
+    frame.figure = figure;
+    frame.level = level;
+    frame.isScene = !current.scene.isEmpty();
+    frame.point_WorldTrans = current.point_WorldTrans;
+    frame.point_PoseTrans = current.point_PoseTrans;
+    frame.point_viewport = current.point_viewport;
+    frame.views.resize(views.size());
+    for (int i = 0; i < views.size(); i++) {
+        frame.views[i].rect = views[i].rect;
+        frame.views[i].projection = views[i].projection;
+        frame.views[i].frustum = views[i].frustum;
+    }
+    frame.stats = stats;
+}
+
+// the numbers of the frame, to the right of the axes
+void RenderArea::paintStats(QPainter& painter)
+{
+    auto ms = [](qint64 ns) { return QString::number(ns / 1e6, 'f', 2) + " ms"; };
+    const QStringList lines = {
+        QString("Faces: %1").arg(stats.facesSubmitted),
+        QString("Culled by normals: %1").arg(stats.facesCulledByNormal),
+        QString("Culled by viewport: %1").arg(stats.facesCulledByViewport),
+        QString("Vertices transformed: %1").arg(stats.verticesTransformed),
+        "Transform: " + ms(stats.transformNs),
+        "Cull: " + ms(stats.cullNs),
+        "Sort: " + ms(stats.sortNs),
+        "Draw: " + ms(stats.drawNs),
+        "Frame: " + ms(stats.frameNs),
+    };
+    painter.setPen(Qt::GlobalColor::darkGray);
+    const int step = painter.fontMetrics().height();
+    for (int i = 0; i < lines.size(); i++)
+        painter.drawText(QPoint(125, 5 + step * (i + 1)), lines.at(i));
+}
+
+void RenderArea::paintView(QPainter& painter, QImage& image, const View& view,
+                           bool isHidingEdges)
+{
+    // Lines may go over all faces at the end when nothing filled has to
+    // cover them: faces are not filled, or only front faces are drawn and
+    // they are not depth sorted. Otherwise each face is outlined as it is
+    // filled, so that back faces drawn first cannot show through. Deferred
+    // shared edges are stroked once from the edge list; hidden edges are
+    // already cut away and go over anything.
+    bool isFilled = current.faceVariant != NONE;
+    bool isDeferringLines = !isFilled
+                         || (current.isNormalMethodEnabled && !current.isZSortingEnabled);
+    bool isStrokingEdges = current.isDrawingWireframe && (isHidingEdges || isDeferringLines);
+
+    // Consecutive faces with the same brush and pen are drawn as one path.
+    // Faces that are both filled and outlined must keep their depth order
+    // and go out one at a time. Back faces are added reversed so that
+    // overlapping faces of one path never cancel under the winding rule.
+    QPen facePen = current.isDrawingWireframe && !isStrokingEdges
+                 ? QPen(Qt::GlobalColor::black) : QPen(Qt::NoPen);
+    bool isLayered = isFilled && facePen.style() != Qt::NoPen;
+    QBrush batchBrush;
+    QPainterPath batch;
+    batch.setFillRule(Qt::WindingFill);
+    auto flush = [&]() {
+        if (batch.isEmpty())
+            return;
+        painter.setBrush(batchBrush);
+        painter.setPen(facePen);
+        painter.drawPath(batch);
+        batch = QPainterPath();
+        batch.setFillRule(Qt::WindingFill);
+    };
+
+    // normals are gathered into one path too, when the lines may be
+    QPainterPath normalsPath;
+    auto drawNormals = [&]() {
+        painter.setPen(Qt::GlobalColor::red);
+        painter.setBrush(Qt::GlobalColor::red);
+        painter.drawPath(normalsPath);
+        normalsPath = QPainterPath();
+    };
+
+    // edges are cut like faces, see polygonOnScreen()
+    const Frustum& frustum = view.frustum;
+    const Coords& points = view.points;
+    const Coords& screen = view.screenPoints();
+    auto clipped = [&](int v) {
+        return frustum.toClip(points.x[v], points.y[v], points.z[v]);
+    };
+
+    // faces of a scene take the color of their instance
+    auto colorOf = [&](int i) {
+        if (current.scene.isEmpty())
+            return figure.colors.at(i);
+        return current.scene.instances.at(view.instances.at(view.polygonSlot.at(i))).color;
+    };
+
+#ifndef POLYHEDRON_NO_STATS
+    int submitted = figure.polygonCount();
+    if (!current.scene.isEmpty()) {
+        submitted = 0;
+        for (const Instance& instance : current.scene.instances)
+            submitted += current.scene.meshOf(instance).polygonCount();
     }
+    stats.facesSubmitted += submitted;
+    stats.facesCulledByViewport += submitted - view.visibleCount;
+#endif
 
     // plot figure
-    for (const auto& p : qAsConst(figure.polygons)) {
-        QVector<QPointF> proj;
-        for (const auto v : p.vertices)
-            proj.push_back(v->point_world.toPointF());
-        if (isNormalMethodEnabled && p.normal_world.z() >= 0) continue;
-        painter.setBrush(faceVariant == RANDOM  ? QBrush(p.color) :
-                         faceVariant == DEFAULT ? QBrush(Qt::GlobalColor::cyan)
-                                                : QBrush(Qt::BrushStyle::NoBrush));
-        painter.setPen(isDrawingWireframe ? Qt::GlobalColor::black
-                                          : Qt::GlobalColor::transparent);
-        painter.drawPolygon(proj);
-        if (isDrawingNormals) {
-            painter.setPen(Qt::GlobalColor::red);
-            painter.setBrush(Qt::GlobalColor::red);
-            painter.drawEllipse(p.mid().toPoint(), 2, 2);
-            painter.drawLine(p.mid().toPoint(), (p.mid()+ p.normal_world).toPoint());
-            painter.drawEllipse((p.mid() + p.normal_world).toPoint(), 4, 4);
+    QPolygonF proj;
+    for (int i : qAsConst(view.drawOrder)) {
+        if (isCulled(view, i)) {
+            STATS_ADD(stats, facesCulledByNormal, 1);
+            continue;
+        }
+        if (isFilled) {
+            polygonOnScreen(view, i, view.backfaces.test(i), proj);
+            if (!proj.isEmpty()) {
+                QBrush brush = current.faceVariant == RANDOM ? QBrush(QColor(colorOf(i)))
+                                                     : QBrush(Qt::GlobalColor::cyan);
+                if (brush != batchBrush) {
+                    flush();
+                    batchBrush = brush;
+                }
+                batch.addPolygon(proj);
+                batch.closeSubpath();
+                if (isLayered)
+                    flush();
+            }
+        }
+        if (current.isDrawingNormals) {
+            QVector3D mid = polygonMid(view, i);
+            QVector3D tip = mid + view.normals[i];
+            QVector4D from = frustum.toClip(mid.x(), mid.y(), mid.z());
+            QVector4D to = frustum.toClip(tip.x(), tip.y(), tip.z());
+            if (clipLine(from, to, frustum)) {
+                normalsPath.addEllipse(project(from), 2, 2);
+                normalsPath.moveTo(project(from));
+                normalsPath.lineTo(project(to));
+                normalsPath.addEllipse(project(to), 4, 4);
+            }
+            if (!isDeferringLines) {
+                flush();
+                drawNormals();
+            }
         }
     }
-    if (isZSortingEnabled) figure.polygons = tmpPolygons;
-    painter.end();
+    flush();
+    if (!normalsPath.isEmpty())
+        drawNormals();
+
+    // plot wireframe; thin lines go straight into the image, where they
+    // cost a small part of what the painter's stroker does
+    auto drawThinLines = [&](const QVector<QLineF>& lines) {
+        if (current.pixelRatio != 1) {
+            painter.setPen(QPen(Qt::GlobalColor::black, 1));
+            painter.drawLines(lines);
+        }
+        else
+            rasterizeLines(image, lines, qRgb(0, 0, 0), view.center(), view.rect);
+    };
+    if (isHidingEdges) {
+        drawThinLines(view.visibleLines);
+        painter.setPen(QPen(Qt::GlobalColor::black, 2));
+        painter.drawLines(view.silhouetteLines);
+    }
+    else if (isStrokingEdges) {
+        QVector<QLineF> lines;
+        // the edges of a mesh whose points and polygons start at the bases
+        auto addEdges = [&](const Polyhedron& mesh, int vertexBase, int polygonBase) {
+            for (const auto& e : mesh.edges) {
+                if (isHidden(view, polygonBase + e.polygons[0])
+                 && (e.polygons[1] < 0 || isHidden(view, polygonBase + e.polygons[1])))
+                    continue;
+                int a = vertexBase + e.vertices[0], b = vertexBase + e.vertices[1];
+                int codeA = view.vertexCodes.at(a), codeB = view.vertexCodes.at(b);
+                if (codeA & codeB & ClipAll)
+                    continue;
+                if ((codeA | codeB) >> GuardShift) {
+                    QVector4D from = clipped(a), to = clipped(b);
+                    if (clipLine(from, to, frustum))
+                        lines.push_back({ project(from), project(to) });
+                    continue;
+                }
+                lines.push_back({ QPointF(screen.x[a], screen.y[a]),
+                                  QPointF(screen.x[b], screen.y[b]) });
+            }
+        };
+        if (current.scene.isEmpty()) {
+            lines.reserve(figure.edges.size());
+            addEdges(figure, 0, 0);
+        }
+        else
+            for (int s = 0; s < view.instances.size(); s++)
+                addEdges(current.scene.meshOf(current.scene.instances.at(view.instances.at(s))),
+                         view.vertexBase.at(s), view.polygonBase.at(s));
+        drawThinLines(lines);
+    }
+}
+
+// The polygon as drawn in the view, around the view's centre. Polygons
+// wholly off one side of the view come out empty, and those that reach
+// past the guard band or the near plane are cut, so that no huge
+// coordinates get to the painter.
+void RenderArea::polygonOnScreen(const View& view, int polygon, bool isReversed,
+                                 QPolygonF& out) const
+{
+    out.resize(0);
+    int base;
+    const Polyhedron& mesh = meshOf(view, polygon, base);
+    const int* vs = mesh.polygon(polygon);
+    const int n = mesh.polygonSize(polygon);
+    int allCodes = ~0, anyCodes = 0;
+    for (int j = 0; j < n; j++) {
+        allCodes &= view.vertexCodes.at(base + vs[j]);
+        anyCodes |= view.vertexCodes.at(base + vs[j]);
+    }
+    if (allCodes & ClipAll)
+        return;
+    if (!(anyCodes >> GuardShift)) {
+        const Coords& screen = view.screenPoints();
+        for (int j = 0; j < n; j++) {
+            int v = base + vs[isReversed ? n - 1 - j : j];
+            out.push_back({ screen.x[v], screen.y[v] });
+        }
+        return;
+    }
+    QVector<QVector4D> clipIn;
+    for (int j = 0; j < n; j++) {
+        int v = base + vs[isReversed ? n - 1 - j : j];
+        clipIn.push_back(view.frustum.toClip(view.points.x[v], view.points.y[v],
+                                             view.points.z[v]));
+    }
+    clipPolygon(clipIn, view.frustum, out);
+}
+
+// The selected face and vertex are drawn over the frame
+void RenderArea::paintSelection(QPainter& painter)
+{
+    QPolygonF outline;
+    QPointF vertex;
+    bool isVertexShown;
+    if (!selectionOutline(outline, vertex, isVertexShown))
+        return;
+    const QColor highlight(255, 140, 0);
+    painter.setRenderHints(QPainter::Antialiasing);
+    painter.translate(frames[front].views[selectedView].center());
+    if (!outline.isEmpty()) {
+        painter.setPen(QPen(highlight, 2));
+        painter.setBrush(QColor(highlight.red(), highlight.green(), highlight.blue(), 80));
+        painter.drawPolygon(outline);
+    }
+    if (isVertexShown) {
+        painter.setPen(Qt::GlobalColor::black);
+        painter.setBrush(highlight);
+        painter.drawEllipse(vertex, 4, 4);
+    }
+}
+
+// The selected face and vertex where the frame on screen shows them,
+// around the centre of their view. Their few points are transformed here
+// again by the frame's matrix, so that the render thread's arrays are
+// never read.
+bool RenderArea::selectionOutline(QPolygonF& outline, QPointF& vertex,
+                                  bool& isVertexShown) const
+{
+    const Frame& shown = frames[front];
+    const Polyhedron& mesh = shown.figure;
+    outline.clear();
+    isVertexShown = false;
+    if (selectedPolygon < 0 || selectedPolygon >= mesh.polygonCount()
+     || selectedView >= shown.views.size())
+        return false;
+    const View& view = shown.views[selectedView];
+    const QMatrix4x4 m = view.projection * shown.point_WorldTrans;
+    auto clipped = [&](int v) {
+        QVector3D p = m * mesh.points[v];
+        return view.frustum.toClip(p.x(), p.y(), p.z());
+    };
+    QVector<QVector4D> clipIn;
+    const int* vs = mesh.polygon(selectedPolygon);
+    for (int j = 0; j < mesh.polygonSize(selectedPolygon); j++)
+        clipIn.push_back(clipped(vs[j]));
+    clipPolygon(clipIn, view.frustum, outline);
+    if (selectedVertex >= 0) {
+        QVector4D p = clipped(selectedVertex);
+        isVertexShown = !(view.frustum.outcode(p) & ClipAll);
+        vertex = project(p);
+    }
+    return true;
+}
+
+// widget area covered by paintSelection()
+QRect RenderArea::selectionRect() const
+{
+    QPolygonF outline;
+    QPointF vertex;
+    bool isVertexShown;
+    if (!selectionOutline(outline, vertex, isVertexShown))
+        return QRect();
+    const int margin = 6;
+    return outline.boundingRect().toAlignedRect()
+                  .translated(frames[front].views[selectedView].center())
+                  .adjusted(-margin, -margin, margin, margin);
+}
+
+int RenderArea::viewAt(const QPoint& pos) const
+{
+    const QVector<View>& views = frames[front].views;
+    for (int i = 0; i < views.size(); i++)
+        if (views[i].rect.contains(pos))
+            return i;
+    return -1;
+}
+
+// A ray through pos, taken back to the figure's own coordinates by the
+// inverse of the transform of the view on screen, tested against the BVH.
+// The side, top and front views flatten the figure along one of its axes
+// before posing it, which cannot be inverted: there the ray is taken back
+// through the pose alone to where it crosses the flattened plane, and
+// every point of the figure along that axis from there lands on pos. It
+// is cast along the axis from the end nearer the eye. Scenes pick nothing.
+bool RenderArea::pick(const QPoint& pos, RayHit& hit) const
+{
+    hit = RayHit();
+    const Frame& shown = frames[front];
+    int index = viewAt(pos);
+    if (index < 0 || shown.isScene)
+        return false;
+    const View& view = shown.views[index];
+    QPointF at = pos - view.center();
+    QVector3D origin, direction;
+    float tMin;
+    if (view.frustum.isPerspective()) {
+        const float d = view.frustum.eyeDistance;
+        origin = QVector3D(0, 0, -d);
+        direction = QVector3D(at.x(), at.y(), d);
+        tMin = view.frustum.nearW;
+    }
+    else {
+        origin = QVector3D(at.x(), at.y(), 0);
+        direction = QVector3D(0, 0, 1);
+        tMin = std::numeric_limits<float>::lowest();
+    }
+
+    bool isInvertible = false;
+    QMatrix4x4 toLocal = (view.projection * shown.point_WorldTrans).inverted(&isInvertible);
+    if (isInvertible)
+        return shown.figure.intersect(toLocal.map(origin), toLocal.mapVector(direction),
+                                      hit, tMin);
+
+    int axis = 0;
+    while (axis < 3 && !shown.point_viewport.column(axis).toVector3D().isNull())
+        axis++;
+    const QMatrix4x4 toView = view.projection * shown.point_PoseTrans;
+    toLocal = toView.inverted(&isInvertible);
+    if (axis == 3 || !isInvertible)
+        return false;
+    const QVector3D from = toLocal.map(origin), along = toLocal.mapVector(direction);
+    if (qFuzzyIsNull(along[axis]))
+        return false;
+    const float t = -from[axis] / along[axis];
+    if (t < tMin)
+        return false;
+    QVector3D flattened;
+    flattened[axis] = 1;
+    if (QVector3D::dotProduct(toView.mapVector(flattened), direction) < 0)
+        flattened = -flattened;
+    return shown.figure.intersect(from + t * along, flattened, hit,
+                                  std::numeric_limits<float>::lowest());
+}
+
+// Every view of the frame on screen is worked out again from its pose.
+// Depth is z / w, which keeps faces flat in perspective; faces reaching
+// behind the eye are left out rather than cut.
+bool RenderArea::exportImage(const QString& fileName, QString* error) const
+{
+    const Frame& shown = frames[front];
+    if (shown.isScene) {
+        if (error)
+            *error = QStringLiteral("Scenes cannot be exported");
+        return false;
+    }
+    const Polyhedron& mesh = shown.figure;
+    QVector<QRgb> colors;
+    if (settings.faceVariant == RANDOM)
+        colors = mesh.colors;
+    else if (settings.faceVariant == DEFAULT)
+        colors.fill(QColor(Qt::GlobalColor::cyan).rgb(), mesh.polygonCount());
+
+    VectorPicture picture;
+    picture.size = size();
+    for (const View& view : shown.views) {
+        const QMatrix4x4 m = view.projection * shown.point_WorldTrans;
+        const Frustum& frustum = view.frustum;
+        Coords screen;
+        screen.resize(mesh.vertexCount());
+        BitMask behind;
+        behind.reset(mesh.vertexCount());
+        for (int v = 0; v < mesh.vertexCount(); v++) {
+            QVector3D p = m * mesh.points[v];
+            QVector4D c = frustum.toClip(p.x(), p.y(), p.z());
+            if (c.w() < frustum.nearW)
+                behind.set(v);
+            screen.set(v, QVector3D(c.x(), c.y(), c.z()) / c.w());
+        }
+        // turned to the viewer when the corners run the same way as
+        // Newell's method gives a normal towards it
+        BitMask facing;
+        facing.reset(mesh.polygonCount());
+        for (int i = 0; i < mesh.polygonCount(); i++) {
+            const int* vs = mesh.polygon(i);
+            float nz = 0;
+            bool isVisible = true;
+            for (int j = 0, k = mesh.polygonSize(i) - 1; j < mesh.polygonSize(i); k = j++) {
+                isVisible = isVisible && !behind.test(vs[j]);
+                nz += (screen.x[vs[k]] - screen.x[vs[j]]) * (screen.y[vs[k]] + screen.y[vs[j]]);
+            }
+            if (isVisible && nz < 0)
+                facing.set(i);
+        }
+        addVisibleSurfaces(picture, mesh, screen, facing, colors,
+                           settings.isDrawingWireframe, frustum.viewport, view.center());
+    }
+    return writeVectorPicture(picture, fileName, error);
+}
+
+// Only the areas of the old and the new selection are repainted, from
+// the frame already rendered
+void RenderArea::select(const QPoint& pos)
+{
+    RayHit hit;
+    pick(pos, hit);
+    int vertex = frames[front].figure.nearestVertex(hit);
+    int index = qMax(0, viewAt(pos));
+    if (hit.polygon == selectedPolygon && vertex == selectedVertex && index == selectedView)
+        return;
+    QWidget::update(selectionRect());
+    selectedPolygon = hit.polygon;
+    selectedVertex = vertex;
+    selectedView = index;
+    QWidget::update(selectionRect());
+    emit selectionChanged(selectedPolygon, selectedVertex);
+}
+
+void RenderArea::clearSelection()
+{
+    if (selectedPolygon < 0)
+        return;
+    selectedPolygon = selectedVertex = -1;
+    emit selectionChanged(-1, -1);
+}
+
+// One view over the whole widget, or four: the figure as it is posed,
+// seen from the front, from the side, from the top and from a corner.
+// The view volumes are set up around the centre of each part; the guard
+// band is wide enough that faces only a little off a view go to the
+// painter uncut.
+void RenderArea::layoutViews()
+{
+    if (!current.isQuadView) {
+        views.resize(1);
+        views[0].title = QString();
+        views[0].rect = QRect(QPoint(), current.size);
+        views[0].projection = QMatrix4x4();
+    }
+    else {
+        QMatrix4x4 side, top, corner;
+        side.rotate(-90, {0, 1, 0});
+        top.rotate(-90, {1, 0, 0});
+        corner.rotate(-45, {0, 1, 0});
+        corner.rotate(-35, {1, 0, 0});
+        const int width = current.size.width(), height = current.size.height();
+        const int w = width / 2, h = height / 2;
+        views.resize(4);
+        views[0].title = "Front";
+        views[0].rect = QRect(0, 0, w, h);
+        views[0].projection = QMatrix4x4();
+        views[1].title = "Side";
+        views[1].rect = QRect(w, 0, width - w, h);
+        views[1].projection = side.transposed();
+        views[2].title = "Top";
+        views[2].rect = QRect(0, h, w, height - h);
+        views[2].projection = top.transposed();
+        views[3].title = "Isometric";
+        views[3].rect = QRect(w, h, width - w, height - h);
+        views[3].projection = corner.transposed();
+    }
+    const float margin = 1;
+    for (View& view : views) {
+        const QRect& r = view.rect;
+        view.frustum.eyeDistance = current.isPerspective ? 2 * qMax(r.width(), r.height()) : 0;
+        view.frustum.viewport = QRectF(r.topLeft() - view.center(), r.size())
+                                .adjusted(-margin, -margin, margin, margin);
+        view.frustum.guardBand = view.frustum.viewport.adjusted(
+                    -r.width(), -r.height(), r.width(), r.height());
+    }
+}
+// Picks the coarsest level that still has a polygon for every few pixels
+// of the figure's projected size, or the full mesh when levels are off
+void RenderArea::selectLevel()
+{
+    const float pixelsPerPolygon = 8;
+    float stretch = 0;
+    for (int c = 0; c < 3; c++)
+        stretch = qMax(stretch, std::hypot(current.point_WorldTrans(0, c),
+                                           current.point_WorldTrans(1, c)));
+    float size = 2 * current.figureRadius * stretch;
+    float wanted = size * size / pixelsPerPolygon;
+    int l = current.isUsingLevelsOfDetail ? current.levels.size() - 1 : 0;
+    while (l > 0 && current.levels[l].polygonCount() < wanted)
+        l--;
+    if (l < 0 || l == level)
+        return;
+    level = l;
+    figure = current.levels[level];
+    dirty |= FigureDirty;
+}
+
+// Walks the BVH with the node boxes transformed by m and keeps the
+// polygons of the nodes that reach into the view volume
+void RenderArea::cullFigure(View& view, const QMatrix4x4& m)
+{
+    STATS_TIMER(cullTimer);
+    const int n = figure.polygonCount();
+    view.visible.reset(n);
+    view.visibleCount = 0;
+    if (figure.bvh.isEmpty())
+        return;
+
+    QVector<int> stack = { 0 };
+    while (!stack.isEmpty()) {
+        const BvhNode& node = figure.bvh.at(stack.takeLast());
+        int anyCodes;
+        if (boxOutcodes(node, m, view.frustum, anyCodes))
+            continue;
+        if (node.left >= 0 && anyCodes) {
+            stack.push_back(node.left);
+            stack.push_back(node.left + 1);
+            continue;
+        }
+        if (node.begin == 0 && node.end == n) {
+            view.visible.fill(n);
+            view.visibleCount = n;
+            break;
+        }
+        for (int k = node.begin; k < node.end; k++)
+            view.visible.set(figure.bvhPolygons.at(k));
+        view.visibleCount += node.end - node.begin;
+    }
+    STATS_TIME(stats, cullNs, cullTimer);
+}
+
+// Transforms what the view shows of the given points and normals
+void RenderArea::transformView(View& view, const Coords& points, const Coords& normals,
+                               const QMatrix4x4& m, const QMatrix4x4& normalMatrix)
+{
+    if (view.visibleCount == figure.polygonCount()) {
+        STATS_ADD(stats, verticesTransformed, figure.vertexCount());
+        transformPoints(m, points, view.points);
+        transformNormals(normalMatrix, normals, view.normals, view.backfaces);
+        return;
+    }
+    view.visibleVertices.reset(figure.vertexCount());
+    view.visible.forEach([&](int i) {
+        const int* vs = figure.polygon(i);
+        for (int j = 0; j < figure.polygonSize(i); j++)
+            view.visibleVertices.set(vs[j]);
+    });
+    STATS_ADD(stats, verticesTransformed, view.visibleVertices.count());
+    transformPoints(m, points, view.points, view.visibleVertices);
+    transformNormals(normalMatrix, normals, view.normals, view.backfaces, view.visible);
+}
+
+// Each view takes the figure straight from local coordinates, through
+// its projection and point_WorldTrans combined into the one matrix it is
+// culled with, so the quad view transforms the mesh once per view.
+void RenderArea::transformFigure()
+{
+    if (!current.isQuadView) {
+        View& view = views[0];
+        cullFigure(view, current.point_WorldTrans);
+        transformView(view, figure.points, figure.normals,
+                      current.point_WorldTrans, current.vector_WorldTrans);
+        return;
+    }
+    for (View& view : views) {
+        const QMatrix4x4 m = view.projection * current.point_WorldTrans;
+        cullFigure(view, m);
+        transformView(view, figure.points, figure.normals, m, NormalVecTransf(m));
+    }
+}
+
+// Outcodes of the view's points and, in perspective, their place on the
+// screen, with depth z / w so that faces stay planes over the screen for
+// the hidden-line depth buffer. With the eye at a finite distance a face
+// turns away when its normal points along the ray from the eye, not z.
+void RenderArea::projectFigure(View& view)
+{
+    const Frustum& frustum = view.frustum;
+    const int n = figure.vertexCount();
+    view.vertexCodes.resize(n);
+    if (frustum.isPerspective())
+        view.screen.resize(n);
+    const Coords& points = view.points;
+    quint16* codes = view.vertexCodes.data();
+    float* sx = view.screen.x.data();
+    float* sy = view.screen.y.data();
+    float* sz = view.screen.z.data();
+    pooledFor(n, [&](int begin, int end) {
+        for (int v = begin; v < end; v++) {
+            QVector4D p = frustum.toClip(points.x.at(v), points.y.at(v), points.z.at(v));
+            codes[v] = quint16(frustum.outcode(p));
+            if (frustum.isPerspective() && p.w() > 0) {
+                sx[v] = p.x() / p.w();
+                sy[v] = p.y() / p.w();
+                sz[v] = p.z() / p.w();
+            }
+        }
+    });
+    if (!frustum.isPerspective())
+        return;
+
+    const float d = frustum.eyeDistance;
+    const Coords& normals = view.normals;
+    const BitMask& visible = view.visible;
+    view.backfaces.reset(figure.polygonCount());
+    quint64* back = view.backfaces.words.data();
+    pooledFor(visible.words.size(), [&](int begin, int end) {
+        for (int w = begin; w < end; w++)
+            for (quint64 bits = visible.words.at(w); bits; bits &= bits - 1) {
+                int i = w * 64 + int(qCountTrailingZeroBits(bits));
+                int v = figure.polygon(i)[0];
+                float toward = normals.x.at(i) * points.x.at(v)
+                             + normals.y.at(i) * points.y.at(v)
+                             + normals.z.at(i) * (points.z.at(v) + d);
+                if (toward >= 0)
+                    back[w] |= quint64(1) << (i & 63);
+            }
+    }, 256);
+}
+
+// Each instance has the view's transform combined with its own once and
+// is culled by the box around its mesh before any of its points is
+// touched. The instances left are transformed, several at a time, into
+// consecutive parts of the view's arrays, so that the rest of the frame
+// sees a single mesh.
+void RenderArea::transformScene(View& view)
+{
+    const Frustum& frustum = view.frustum;
+    const QMatrix4x4 toView = view.projection * current.point_WorldTrans;
+    const int count = current.scene.instances.size();
+    QVector<QMatrix4x4> matrices(count);
+    QVector<char> isShown(count);
+    QMatrix4x4* matrix = matrices.data();
+    char* shown = isShown.data();
+    STATS_TIMER(cullTimer);
+    pooledFor(count, [&](int begin, int end) {
+        for (int k = begin; k < end; k++) {
+            const Instance& instance = current.scene.instances.at(k);
+            const Polyhedron& mesh = current.scene.meshOf(instance);
+            matrix[k] = toView * instance.model;
+            int anyCodes;
+            shown[k] = !mesh.bvh.isEmpty()
+                    && !boxOutcodes(mesh.bvh.at(0), matrix[k], frustum, anyCodes);
+        }
+    }, 1024);
+
+    view.instances.resize(0);
+    view.vertexBase = { 0 };
+    view.polygonBase = { 0 };
+    for (int k = 0; k < count; k++) {
+        if (!shown[k])
+            continue;
+        const Polyhedron& mesh = current.scene.meshOf(current.scene.instances.at(k));
+        view.instances.push_back(k);
+        view.vertexBase.push_back(view.vertexBase.last() + mesh.vertexCount());
+        view.polygonBase.push_back(view.polygonBase.last() + mesh.polygonCount());
+    }
+    STATS_TIME(stats, cullNs, cullTimer);
+    const int vertices = view.vertexBase.last(), polygons = view.polygonBase.last();
+    STATS_ADD(stats, verticesTransformed, vertices);
+    view.points.resize(vertices);
+    view.screen.resize(frustum.isPerspective() ? vertices : 0);
+    view.vertexCodes.resize(vertices);
+    view.normals.resize(polygons);
+    view.polygonSlot.resize(polygons);
+    float *px = view.points.x.data(), *py = view.points.y.data(), *pz = view.points.z.data();
+    float *sx = view.screen.x.data(), *sy = view.screen.y.data(), *sz = view.screen.z.data();
+    float *nx = view.normals.x.data(), *ny = view.normals.y.data(), *nz = view.normals.z.data();
+    quint16* codes = view.vertexCodes.data();
+    int* slotOf = view.polygonSlot.data();
+    pooledFor(view.instances.size(), [&](int begin, int end) {
+        for (int s = begin; s < end; s++) {
+            const int k = view.instances.at(s);
+            const Polyhedron& mesh = current.scene.meshOf(current.scene.instances.at(k));
+            const QMatrix4x4& m = matrices.at(k);
+            const QMatrix4x4 normalMatrix = NormalVecTransf(m);
+            const int vertexBase = view.vertexBase.at(s);
+            const int polygonBase = view.polygonBase.at(s);
+            for (int v = 0; v < mesh.vertexCount(); v++) {
+                const int o = vertexBase + v;
+                QVector3D p = m * mesh.points[v];
+                px[o] = p.x(); py[o] = p.y(); pz[o] = p.z();
+                QVector4D c = frustum.toClip(p.x(), p.y(), p.z());
+                codes[o] = quint16(frustum.outcode(c));
+                if (frustum.isPerspective() && c.w() > 0) {
+                    sx[o] = c.x() / c.w();
+                    sy[o] = c.y() / c.w();
+                    sz[o] = c.z() / c.w();
+                }
+            }
+            for (int i = 0; i < mesh.polygonCount(); i++) {
+                const int o = polygonBase + i;
+                QVector3D n = normalMatrix.mapVector(mesh.normals[i]);
+                nx[o] = n.x(); ny[o] = n.y(); nz[o] = n.z();
+                slotOf[o] = s;
+            }
+        }
+    }, 64);
+
+    // back faces as transformNormals() and projectFigure() find them
+    const float d = frustum.eyeDistance;
+    view.backfaces.reset(polygons);
+    quint64* back = view.backfaces.words.data();
+    pooledFor(view.backfaces.words.size(), [&](int begin, int end) {
+        for (int w = begin; w < end; w++)
+            for (int i = w * 64; i < qMin(polygons, w * 64 + 64); i++) {
+                float toward = nz[i];
+                if (frustum.isPerspective()) {
+                    int polygon = i, base;
+                    const Polyhedron& mesh = meshOf(view, polygon, base);
+                    int v = base + mesh.polygon(polygon)[0];
+                    toward = nx[i] * px[v] + ny[i] * py[v] + nz[i] * (pz[v] + d);
+                }
+                if (toward >= 0)
+                    back[w] |= quint64(1) << (i & 63);
+            }
+    }, 256);
+    view.visible.fill(polygons);
+    view.visibleCount = polygons;
+}
+
+// The mesh the view's polygon comes from, with polygon turned into its
+// number there and base set to where the mesh's points start in the
+// view: the figure itself unless a scene is shown
+const Polyhedron& RenderArea::meshOf(const View& view, int& polygon, int& base) const
+{
+    base = 0;
+    if (current.scene.isEmpty())
+        return figure;
+    const int slot = view.polygonSlot.at(polygon);
+    polygon -= view.polygonBase.at(slot);
+    base = view.vertexBase.at(slot);
+    return current.scene.meshOf(current.scene.instances.at(view.instances.at(slot)));
+}
+
+// centroid of the view's polygon as transformed
+QVector3D RenderArea::polygonMid(const View& view, int polygon) const
+{
+    int base;
+    const Polyhedron& mesh = meshOf(view, polygon, base);
+    const int* vs = mesh.polygon(polygon);
+    QVector3D s;
+    for (int j = 0; j < mesh.polygonSize(polygon); j++)
+        s += view.points[base + vs[j]];
+    return s / mesh.polygonSize(polygon);
+}
+
+void RenderArea::sortPolygons(View& view)
+{
+    QVector<int>& drawOrder = view.drawOrder;
+    drawOrder.resize(0);
+    drawOrder.reserve(view.visibleCount);
+    view.visible.forEach([&](int i) { drawOrder.push_back(i); });
+    if (!current.isZSortingEnabled)
+        return;
+    QVector<float> depth(view.normals.size());
+    for (int i : qAsConst(drawOrder))
+        depth[i] = polygonMid(view, i).z();
+    const Coords& normals = view.normals;
+    std::sort(drawOrder.begin(), drawOrder.end(), [&](int lhs, int rhs) {
+        if (!qFuzzyCompare(depth[lhs], depth[rhs]))
+            return depth[lhs] > depth[rhs];
+        return normals.z[lhs] > normals.z[rhs];
+    });
+}
+
+// Rasterizes the depth of the front faces and keeps the parts of their
+// edges that are not behind it
+void RenderArea::findHiddenLines(View& view)
+{
+    BitMask front = view.visible;
+    for (int w = 0; w < front.words.size(); w++)
+        front.words[w] &= ~view.backfaces.words.value(w);
+    // faces crossing the near plane have no place on the screen; they are
+    // left out, so their edges show as silhouettes
+    if (view.frustum.isPerspective()) {
+        view.visible.forEach([&](int i) {
+            const int* vs = figure.polygon(i);
+            for (int j = 0; j < figure.polygonSize(i); j++)
+                if (view.vertexCodes.at(vs[j]) & ClipNear) {
+                    front.words[i >> 6] &= ~(quint64(1) << (i & 63));
+                    break;
+                }
+        });
+    }
+    QRect area(view.rect.topLeft() - view.center(), view.rect.size());
+    view.depthBuffer.render(figure, view.screenPoints(), front, area);
+    findVisibleEdges(figure, view.screenPoints(), front, view.depthBuffer,
+                     view.visibleLines, view.silhouetteLines);
 }
 
 void RenderArea::mousePressEvent(QMouseEvent *event)
 {
     prevPos = event->pos();
+    pressPos = event->pos();
     setCursor(Qt::CursorShape::DragMoveCursor);
 }
 
@@ -133,9 +1075,12 @@ void RenderArea::mouseMoveEvent(QMouseEvent *event)
     prevPos = event->pos();
 }
 
-void RenderArea::mouseReleaseEvent(QMouseEvent*)
+// a click that did not drag selects
+void RenderArea::mouseReleaseEvent(QMouseEvent *event)
 {
     unsetCursor();
+    if (event->pos() == pressPos)
+        select(event->pos());
 }
 
 void RenderArea::wheelEvent(QWheelEvent *event)
@@ -151,6 +1096,11 @@ void RenderArea::wheelEvent(QWheelEvent *event)
     setScale(scale + E * 0.003);
 }
 
+void RenderArea::resizeEvent(QResizeEvent*)
+{
+    invalidate(MatricesDirty);
+}
+
 QMatrix4x4 RenderArea::NormalVecTransf(const QMatrix4x4 &m)
 {
     return QMatrix4x4(
@@ -166,10 +1116,55 @@ QMatrix4x4 RenderArea::NormalVecTransf(const QMatrix4x4 &m)
                 0,           0,           0,           0);
 }
 
+// The levels of detail are built on their own thread, as simplifying a
+// large import takes seconds. The full mesh is shown as soon as its edges
+// and bounding volumes are there, in place of what was shown before, and
+// the coarser levels join it when they are done. Whatever is built for a
+// figure that was replaced meanwhile is dropped.
 void RenderArea::setFigure(const Polyhedron &newFigure)
 {
-    figure = newFigure;
-    update();
+    const int generation = figureGeneration.fetchAndAddOrdered(1) + 1;
+    QMetaObject::invokeMethod(&levelContext, [this, newFigure, generation]() {
+        Polyhedron full = newFigure;
+        full.buildEdges();
+        full.buildBvh();
+        QMetaObject::invokeMethod(this, [this, full, generation]() {
+            if (generation != figureGeneration.loadAcquire())
+                return;
+            settings.scene = Scene();
+            settings.levels = { full };
+            QVector3D lower, upper;
+            full.bounds(lower, upper);
+            settings.figureRadius = (upper - lower).length() / 2;
+            clearSelection();
+            invalidate(FigureDirty);
+        }, Qt::QueuedConnection);
+
+        if (generation != figureGeneration.loadAcquire())
+            return;
+        QVector<Polyhedron> coarser = simplifyLevels(newFigure);
+        for (Polyhedron& l : coarser) {
+            l.buildEdges();
+            l.buildBvh();
+        }
+        QMetaObject::invokeMethod(this, [this, coarser, generation]() {
+            if (generation != figureGeneration.loadAcquire())
+                return;
+            settings.levels.resize(1);
+            settings.levels += coarser;
+            invalidate(FigureDirty);
+            emit levelsReady();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void RenderArea::setScene(const Scene &newScene)
+{
+    figureGeneration.fetchAndAddOrdered(1);
+    settings.scene = newScene;
+    settings.levels.clear();
+    clearSelection();
+    invalidate(FigureDirty);
 }
 
 void RenderArea::setPoint_viewport(const QMatrix4x4 &newPoint_viewport)
@@ -180,31 +1175,56 @@ void RenderArea::setPoint_viewport(const QMatrix4x4 &newPoint_viewport)
 
 void RenderArea::setIsZSortingEnabled(bool newIsZSortingEnabled)
 {
-    isZSortingEnabled = newIsZSortingEnabled;
-    update();
+    settings.isZSortingEnabled = newIsZSortingEnabled;
+    invalidate(OrderDirty);
+}
+
+void RenderArea::setIsHidingLines(bool newIsHidingLines)
+{
+    settings.isHidingLines = newIsHidingLines;
+    invalidate(VisualDirty);
+}
+
+void RenderArea::setIsQuadView(bool newIsQuadView)
+{
+    settings.isQuadView = newIsQuadView;
+    invalidate(MatricesDirty);
+}
+
+void RenderArea::setIsUsingLevelsOfDetail(bool newIsUsingLevelsOfDetail)
+{
+    settings.isUsingLevelsOfDetail = newIsUsingLevelsOfDetail;
+    invalidate(MatricesDirty);
+}
+
+void RenderArea::setIsShowingStats(bool newIsShowingStats)
+{
+    settings.isShowingStats = newIsShowingStats;
+    invalidate(VisualDirty);
 }
 
 void RenderArea::setIsNormalMethodEnabled(bool newIsNormalMethodEnabled)
 {
-    isNormalMethodEnabled = newIsNormalMethodEnabled;
-    update();
+    settings.isNormalMethodEnabled = newIsNormalMethodEnabled;
+    invalidate(VisualDirty);
 }
 
 void RenderArea::setIsDrawingNormals(bool newIsDrawingNormals)
 {
-    isDrawingNormals = newIsDrawingNormals;
-    update();
+    settings.isDrawingNormals = newIsDrawingNormals;
+    invalidate(VisualDirty);
 }
 
 void RenderArea::setIsDrawWireframe(bool newIsDrawWireframe)
 {
-    isDrawingWireframe = newIsDrawWireframe;
-    update();
+    settings.isDrawingWireframe = newIsDrawWireframe;
+    invalidate(VisualDirty);
 }
 
 void RenderArea::setSideView()
 {
     point_viewport = viewSide;
+    settings.isPerspective = false;
     QMatrix4x4 E;
     E.rotate(-90, {0, 1, 0});
     setRotate(E);
@@ -214,6 +1234,7 @@ void RenderArea::setSideView()
 void RenderArea::setFrontView()
 {
     point_viewport = viewFront;
+    settings.isPerspective = false;
     setRotate({});
     update();
 }
@@ -221,6 +1242,7 @@ void RenderArea::setFrontView()
 void RenderArea::setTopView()
 {
     point_viewport = viewTop;
+    settings.isPerspective = false;
     QMatrix4x4 E;
     E.rotate(-90, {1, 0, 0});
     setRotate(E);
@@ -230,6 +1252,14 @@ void RenderArea::setTopView()
 void RenderArea::setOrthoView()
 {
     point_viewport = viewOrtho;
+    settings.isPerspective = false;
+    update();
+}
+
+void RenderArea::setPerspectiveView()
+{
+    point_viewport = viewOrtho;
+    settings.isPerspective = true;
     update();
 }
 
@@ -243,10 +1273,10 @@ void RenderArea::positIsometric()
 
 void RenderArea::setFaceVariant(FaceVariant newFaceVariant)
 {
-    if (faceVariant == newFaceVariant)
+    if (settings.faceVariant == newFaceVariant)
         return;
-    faceVariant = newFaceVariant;
-    update();
+    settings.faceVariant = newFaceVariant;
+    invalidate(VisualDirty);
 }
 
 void RenderArea::rotateX(double degree, bool silent)
@@ -4,9 +4,22 @@
 #include <QWidget>
 #include <QPaintEvent>
 #include <QPainter>
+#include <QPainterPath>
+#include <QImage>
 #include <QMatrix4x4>
+#include <QThread>
+#include <QAtomicInt>
 #include <cmath>
+#include <numeric>
+#include "clipping.h"
+#include "hiddenline.h"
+#include "lineraster.h"
 #include "polyhedron.h"
+#include "renderstats.h"
+#include "scene.h"
+#include "simplify.h"
+#include "transform.h"
+#include "vectorexport.h"
 
 class RenderArea : public QWidget
 {
@@ -15,6 +28,7 @@ public:
     enum FaceVariant { NONE, RANDOM, DEFAULT };
 
     RenderArea(QWidget *parent);
+    ~RenderArea();
 
     void resize(int w, int h);
 
@@ -44,10 +58,31 @@ public:
 
     void setIsZSortingEnabled(bool newIsZSortingEnabled);
 
+    void setIsHidingLines(bool newIsHidingLines);
+
+    void setIsQuadView(bool newIsQuadView);
+
+    void setIsShowingStats(bool newIsShowingStats);
+
+    // draws the full mesh whatever its size on screen when false
+    void setIsUsingLevelsOfDetail(bool newIsUsingLevelsOfDetail);
+
     void setPoint_viewport(const QMatrix4x4 &newPoint_viewport);
 
+    // shows the figure once it is ready to draw and levelsReady() once its
+    // coarser levels of detail are there too
     void setFigure(const Polyhedron &newFigure);
 
+    // shows the scene in place of the figure until the next setFigure()
+    void setScene(const Scene &newScene);
+
+    // the nearest face under the widget point pos
+    bool pick(const QPoint& pos, RayHit& hit) const;
+
+    // writes the figure of the frame on screen as SVG or PDF, with only
+    // the parts of faces and edges that are not hidden
+    bool exportImage(const QString& fileName, QString* error = nullptr) const;
+
 public slots:
     void setIsDrawWireframe(bool newIsDrawWireframe);
 
@@ -59,6 +94,8 @@ public slots:
 
     void setOrthoView();
 
+    void setPerspectiveView();
+
     void positIsometric();
 
 signals:
@@ -70,31 +107,197 @@ signals:
 
     void debug(QMatrix4x4);
 
+    void statsChanged(RenderStats);
+
+    void levelsReady();
+
+    void selectionChanged(int polygon, int vertex);
+
 protected:
     virtual void paintEvent       (QPaintEvent *event) override;
     virtual void mousePressEvent  (QMouseEvent *event) override;
     virtual void mouseMoveEvent   (QMouseEvent *event) override;
     virtual void mouseReleaseEvent(QMouseEvent *event) override;
     virtual void wheelEvent       (QWheelEvent *event) override;
+    virtual void resizeEvent      (QResizeEvent *event) override;
+
+private:
+    enum DirtyFlag {
+        MatricesDirty = 0x1,
+        FigureDirty   = 0x2,
+        OrderDirty    = 0x4,
+        VisualDirty   = 0x8,
+        LinesDirty    = 0x10,
+    };
+
+    // Everything a frame is drawn from. The widget changes its own copy,
+    // and the render thread draws from a copy taken when the frame starts.
+    struct Settings
+    {
+        QSize size;
+        qreal pixelRatio = 1;
+        QMatrix4x4 rotate;             // for the axes
+        QMatrix4x4 point_WorldTrans;
+        QMatrix4x4 point_PoseTrans;    // point_WorldTrans before point_viewport flattens it
+        QMatrix4x4 point_viewport;
+        QMatrix4x4 vector_WorldTrans;
+        QVector<Polyhedron> levels;    // full mesh first, then ever coarser
+        float figureRadius = 0;
+        Scene scene;                   // drawn instead of the figure when not empty
+        FaceVariant faceVariant = NONE;
+        bool isDrawingWireframe = true;
+        bool isDrawingNormals = false;
+        bool isNormalMethodEnabled = true;
+        bool isZSortingEnabled = false;
+        bool isPerspective = false;
+        bool isHidingLines = false;
+        bool isQuadView = false;
+        bool isShowingStats = false;
+        bool isUsingLevelsOfDetail = true;
+        uint dirty = MatricesDirty | FigureDirty | OrderDirty | VisualDirty | LinesDirty;
+    };
+
+    // One picture of the figure inside the widget, with everything that
+    // depends on where it is looked at from
+    struct View
+    {
+        QString title;
+        QRect rect;              // part of the widget it is drawn into
+        QMatrix4x4 projection;   // turns the shared world points to the view
+        Frustum frustum;         // around the centre of rect
+        Coords points;
+        Coords normals;
+        Coords screen;           // points divided by w in perspective
+        QVector<quint16> vertexCodes; // outcodes of points
+        BitMask backfaces;
+        BitMask visible;         // polygons that may show inside rect
+        BitMask visibleVertices;
+        int visibleCount = 0;
+        QVector<int> drawOrder;
+        DepthBuffer depthBuffer;
+        QVector<QLineF> visibleLines;  // edges cut to their unobstructed parts
+        QVector<QLineF> silhouetteLines;
+        // The scene's instances that reach into the view, one after another
+        // in the arrays above; the bases have one more entry, the totals
+        QVector<int> instances;
+        QVector<int> vertexBase;
+        QVector<int> polygonBase;
+        QVector<int> polygonSlot;    // which of instances a polygon is from
+
+        // where the figure is drawn from: the transformed points
+        // themselves, or divided by w in perspective
+        const Coords& screenPoints() const
+        { return frustum.isPerspective() ? screen : points; }
+
+        QPoint center() const
+        { return rect.topLeft() + QPoint(rect.width() / 2, rect.height() / 2); }
+    };
+
+    // A finished picture, with what picking and the selection need to
+    // know of how it was drawn: the views hold only their place and
+    // projection
+    struct Frame
+    {
+        QImage image;
+        Polyhedron figure;
+        int level = 0;
+        bool isScene = false;
+        QMatrix4x4 point_WorldTrans;
+        QMatrix4x4 point_PoseTrans;
+        QMatrix4x4 point_viewport;
+        QVector<View> views;
+        RenderStats stats;
+    };
+
+    static QMatrix4x4 NormalVecTransf(const QMatrix4x4& m);
+
+    void invalidate(uint flags);
+
+    void layoutViews();
+
+    void selectLevel();
+
+    void cullFigure(View& view, const QMatrix4x4& m);
+
+    void transformView(View& view, const Coords& points, const Coords& normals,
+                       const QMatrix4x4& m, const QMatrix4x4& normalMatrix);
+
+    void transformFigure();
+
+    void projectFigure(View& view);
+
+    void transformScene(View& view);
+
+    const Polyhedron& meshOf(const View& view, int& polygon, int& base) const;
+
+    QVector3D polygonMid(const View& view, int polygon) const;
+
+    void sortPolygons(View& view);
+
+    void findHiddenLines(View& view);
+
+    void startFrame();
+
+    void showFrame(int finished);
+
+    void renderFrame(Frame& frame);
+
+    void paintView(QPainter& painter, QImage& image, const View& view,
+                   bool isHidingEdges);
+
+    void paintSelection(QPainter& painter);
+
+    bool selectionOutline(QPolygonF& outline, QPointF& vertex, bool& isVertexShown) const;
+
+    void paintStats(QPainter& painter);
+
+    void polygonOnScreen(const View& view, int polygon, bool isReversed,
+                         QPolygonF& out) const;
+
+    int viewAt(const QPoint& pos) const;
+
+    void select(const QPoint& pos);
+
+    void clearSelection();
+
+    QRect selectionRect() const;
+
+    bool isCulled(const View& view, int polygon) const
+    { return current.isNormalMethodEnabled && view.backfaces.test(polygon); }
 
-private: QMatrix4x4 NormalVecTransf(const QMatrix4x4& m);
+    bool isHidden(const View& view, int polygon) const
+    { return !view.visible.test(polygon) || isCulled(view, polygon); }
 
 private:
-    Polyhedron figure;
+    // the render thread's; the widget does not touch them
+    Settings current;             // what the frame in the works is drawn from
+    Polyhedron figure;            // the level of detail being drawn
+    int level;
+    QVector<View> views;
+    RenderStats stats;        // of the frame
+    uint dirty;
+
+    // the widget's
+    Settings settings;
+    Frame frames[2];          // the one on screen and the one being drawn
+    int front;
+    bool isRendering;
+    QThread renderThread;
+    QObject renderContext;    // lives in renderThread and runs the frames
+    QThread levelThread;
+    QObject levelContext;     // lives in levelThread and builds the levels
+    QAtomicInt figureGeneration;  // of the last setFigure() or setScene()
+    int selectedPolygon;
+    int selectedVertex;
+    int selectedView;
     QMatrix4x4 scale;
     QMatrix4x4 rotate;
     QMatrix4x4 shift;
     QMatrix4x4 projecion;
     QPoint prevPos;
-    QMatrix4x4 point_WorldTrans;
-    QMatrix4x4 vector_WorldTrans;
+    QPoint pressPos;
     QMatrix4x4 point_viewport;
-    FaceVariant faceVariant;
     QBrush polygonPainting;
-    bool isDrawingWireframe;
-    bool isDrawingNormals;
-    bool isNormalMethodEnabled;
-    bool isZSortingEnabled;
     static const QMatrix4x4 viewSide;
     static const QMatrix4x4 viewTop;
     static const QMatrix4x4 viewFront;
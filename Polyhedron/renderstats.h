@@ -0,0 +1,39 @@
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include <QElapsedTimer>
+#include <QMetaType>
+
+// What the last rendered frame cost, summed over its views. Faces are
+// counted when they are painted, so they are there every frame; vertices,
+// transforming, culling and sorting only when the frame had to redo them.
+// Culling is the walk over the bounding boxes, timed apart from the
+// transforms around it. Defining
+// POLYHEDRON_NO_STATS compiles every counter and timer away and leaves
+// the numbers at zero.
+struct RenderStats
+{
+    int facesSubmitted = 0;
+    int facesCulledByNormal = 0;
+    int facesCulledByViewport = 0;
+    int verticesTransformed = 0;
+    qint64 transformNs = 0;
+    qint64 cullNs = 0;
+    qint64 sortNs = 0;
+    qint64 drawNs = 0;
+    qint64 frameNs = 0;
+};
+
+Q_DECLARE_METATYPE(RenderStats)
+
+#ifndef POLYHEDRON_NO_STATS
+#define STATS_ADD(stats, field, n) ((stats).field += (n))
+#define STATS_TIMER(timer) QElapsedTimer timer; timer.start()
+#define STATS_TIME(stats, field, timer) ((stats).field += (timer).nsecsElapsed())
+#else
+#define STATS_ADD(stats, field, n) ((void)0)
+#define STATS_TIMER(timer) ((void)0)
+#define STATS_TIME(stats, field, timer) ((void)0)
+#endif
+
+#endif // RENDERSTATS_H
@@ -0,0 +1,70 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <QMatrix4x4>
+#include <QSharedPointer>
+#include "polyhedron.h"
+
+// One placement of a mesh of the scene
+struct Instance
+{
+    int mesh;           // index into Scene::meshes
+    QMatrix4x4 model;   // from the mesh's coordinates to the scene's
+    QRgb color;
+};
+
+// Many polyhedra made of a few meshes. A mesh is frozen once it is in the
+// scene, so that any number of instances can share it; they only carry
+// their own matrix and color.
+struct Scene
+{
+    QVector<QSharedPointer<const Polyhedron> > meshes;
+    QVector<Instance> instances;
+
+    bool isEmpty() const { return instances.isEmpty(); }
+    const Polyhedron& meshOf(const Instance& instance) const { return *meshes.at(instance.mesh); }
+
+    int addMesh(Polyhedron mesh);
+    void addInstance(int mesh, const QMatrix4x4& model, QRgb color);
+
+    static Scene GenerateCubeField(int side);
+};
+
+// the mesh gets the edges and the BVH the renderer needs
+inline int Scene::addMesh(Polyhedron mesh)
+{
+    mesh.buildEdges();
+    mesh.buildBvh();
+    meshes.push_back(QSharedPointer<const Polyhedron>(new Polyhedron(std::move(mesh))));
+    return meshes.size() - 1;
+}
+
+inline void Scene::addInstance(int mesh, const QMatrix4x4& model, QRgb color)
+{
+    instances.push_back({ mesh, model, color });
+}
+
+// side^3 small cubes in a grid the size of one figure, each turned its
+// own way and colored by its number
+inline Scene Scene::GenerateCubeField(int side)
+{
+    const float L = 50;
+    const float step = 2 * L / side;
+    Scene scene;
+    const int cube = scene.addMesh(Polyhedron::GenerateCube());
+    for (int i = 0; i < side; i++)
+        for (int j = 0; j < side; j++)
+            for (int k = 0; k < side; k++) {
+                quint32 h = quint32(scene.instances.size()) * 0x9E3779B1u;
+                h ^= h >> 15; h *= 0x2C1B3C6Du; h ^= h >> 12;
+                QMatrix4x4 model;
+                model.translate(-L + step * (i + 0.5f), -L + step * (j + 0.5f),
+                                -L + step * (k + 0.5f));
+                model.rotate(h % 360, QVector3D(h & 0x100 ? 1 : 0.3f, h & 0x200 ? 1 : 0.3f, 1));
+                model.scale(0.3f * step / L);
+                scene.addInstance(cube, model, h);
+            }
+    return scene;
+}
+
+#endif // SCENE_H
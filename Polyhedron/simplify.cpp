@@ -0,0 +1,425 @@
+#include "simplify.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Symmetric 4x4 matrix of the error form, upper triangle row by row
+struct Quadric
+{
+    double a[10] = {};
+
+    Quadric& operator+=(const Quadric& q)
+    {
+        for (int i = 0; i < 10; i++)
+            a[i] += q.a[i];
+        return *this;
+    }
+
+    // squared distance to the plane n.p + d = 0 times weight
+    static Quadric plane(double nx, double ny, double nz, double d, double weight)
+    {
+        Quadric q;
+        const double p[4] = { nx, ny, nz, d };
+        for (int r = 0, i = 0; r < 4; r++)
+            for (int c = r; c < 4; c++)
+                q.a[i++] = p[r] * p[c] * weight;
+        return q;
+    }
+
+    double error(double x, double y, double z) const
+    {
+        return a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x
+             + a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y
+             + a[7]*z*z + 2*a[8]*z
+             + a[9];
+    }
+
+    // point of least error; false when the form has no single minimum
+    bool optimum(double& x, double& y, double& z) const
+    {
+        const double m00 = a[0], m01 = a[1], m02 = a[2],
+                     m11 = a[4], m12 = a[5], m22 = a[7];
+        const double c0 = m11 * m22 - m12 * m12;
+        const double c1 = m02 * m12 - m01 * m22;
+        const double c2 = m01 * m12 - m02 * m11;
+        const double det = m00 * c0 + m01 * c1 + m02 * c2;
+        const double trace = (m00 + m11 + m22) / 3;
+        if (std::abs(det) <= 1e-6 * trace * trace * trace)
+            return false;
+        const double b0 = -a[3], b1 = -a[6], b2 = -a[8];
+        x = (c0 * b0 + c1 * b1 + c2 * b2) / det;
+        y = (c1 * b0 + (m00 * m22 - m02 * m02) * b1
+                     + (m01 * m02 - m00 * m12) * b2) / det;
+        z = (c2 * b0 + (m01 * m02 - m00 * m12) * b1
+                     + (m00 * m11 - m01 * m01) * b2) / det;
+        return true;
+    }
+};
+
+struct Collapse
+{
+    float cost;
+    int a, b;      // b is merged into a
+    float x, y, z; // where a ends up
+};
+
+class Simplifier
+{
+public:
+    explicit Simplifier(const Polyhedron& mesh);
+
+    int triangleCount() const { return tris.size() / 3; }
+    // false when no collapse is left before reaching the target
+    bool reduceTo(int triangles);
+    Polyhedron toPolyhedron(float normalLength) const;
+
+private:
+    void buildAdjacency();
+    void collectNeighbours(int v, QVector<int>& out) const;
+    QVector<Collapse> evaluate() const;
+    bool evaluate(int a, int b, Collapse& collapse) const;
+    bool isValid(const Collapse& collapse) const;
+    void select(QVector<Collapse>& collapses, int budget) const;
+    void apply(const QVector<Collapse>& collapses);
+
+    Coords points;
+    QVector<Quadric> quadrics;
+    QVector<int> tris;             // three corners per triangle
+    QVector<QRgb> colors;
+    QVector<int> vertexTris;       // triangles around vertex v are
+    QVector<int> vertexOffsets;    // vertexTris[vertexOffsets[v] .. vertexOffsets[v+1])
+    QVector<int> neighbours;       // vertices next to v, ascending, are
+    QVector<int> neighbourOffsets; // neighbours[neighbourOffsets[v] .. neighbourOffsets[v+1])
+    QVector<char> boundary;
+};
+
+QVector3D normal(const QVector3D& a, const QVector3D& b, const QVector3D& c)
+{
+    return QVector3D::crossProduct(b - a, c - a);
+}
+
+Simplifier::Simplifier(const Polyhedron& mesh)
+    : points(mesh.points)
+{
+    for (int i = 0; i < mesh.polygonCount(); i++) {
+        const int* vs = mesh.polygon(i);
+        for (int j = 2; j < mesh.polygonSize(i); j++) {
+            tris << vs[0] << vs[j - 1] << vs[j];
+            colors << mesh.colors.value(i);
+        }
+    }
+    buildAdjacency();
+
+    // area weighted plane quadrics, summed around every vertex
+    QVector<Quadric> planes(triangleCount());
+    Quadric* plane = planes.data();
+    parallelFor(triangleCount(), [&](int begin, int end) {
+        for (int t = begin; t < end; t++) {
+            QVector3D p = points[tris[3 * t]];
+            QVector3D n = normal(p, points[tris[3 * t + 1]], points[tris[3 * t + 2]]);
+            double area = n.length() / 2;
+            n.normalize();
+            plane[t] = Quadric::plane(n.x(), n.y(), n.z(),
+                                      -QVector3D::dotProduct(n, p), area);
+        }
+    });
+    quadrics.resize(points.size());
+    Quadric* q = quadrics.data();
+    parallelFor(points.size(), [&](int begin, int end) {
+        for (int v = begin; v < end; v++)
+            for (int k = vertexOffsets[v]; k < vertexOffsets[v + 1]; k++)
+                q[v] += planes[vertexTris[k]];
+    });
+}
+
+void Simplifier::buildAdjacency()
+{
+    vertexOffsets.fill(0, points.size() + 1);
+    for (int v : qAsConst(tris))
+        vertexOffsets[v + 1]++;
+    std::partial_sum(vertexOffsets.begin(), vertexOffsets.end(),
+                     vertexOffsets.begin());
+    vertexTris.resize(tris.size());
+    QVector<int> fill = vertexOffsets;
+    for (int k = 0; k < tris.size(); k++)
+        vertexTris[fill[tris[k]]++] = k / 3;
+
+    // neighbour lists, counted first and then filled; a vertex is on the
+    // boundary if one of its edges has a single triangle
+    neighbourOffsets.fill(0, points.size() + 1);
+    boundary.fill(0, points.size());
+    int* count = neighbourOffsets.data() + 1;
+    char* onBoundary = boundary.data();
+    parallelFor(points.size(), [&](int begin, int end) {
+        QVector<int> around;
+        for (int v = begin; v < end; v++) {
+            collectNeighbours(v, around);
+            for (int k = 0; k < around.size(); k++) {
+                bool isFirst = k == 0 || around[k - 1] != around[k];
+                count[v] += isFirst;
+                if (isFirst && (k + 1 == around.size() || around[k + 1] != around[k]))
+                    onBoundary[v] = 1;
+            }
+        }
+    });
+    std::partial_sum(neighbourOffsets.begin(), neighbourOffsets.end(),
+                     neighbourOffsets.begin());
+    neighbours.resize(neighbourOffsets.last());
+    int* next = neighbours.data();
+    parallelFor(points.size(), [&](int begin, int end) {
+        QVector<int> around;
+        for (int v = begin; v < end; v++) {
+            collectNeighbours(v, around);
+            int* out = next + neighbourOffsets[v];
+            for (int k = 0; k < around.size(); k++)
+                if (k == 0 || around[k - 1] != around[k])
+                    *out++ = around[k];
+        }
+    });
+}
+
+// the other corners of the triangles around v, sorted, with repeats
+void Simplifier::collectNeighbours(int v, QVector<int>& out) const
+{
+    out.resize(0);
+    for (int k = vertexOffsets[v]; k < vertexOffsets[v + 1]; k++) {
+        const int* t = tris.constData() + 3 * vertexTris[k];
+        for (int j = 0; j < 3; j++)
+            if (t[j] != v)
+                out.push_back(t[j]);
+    }
+    std::sort(out.begin(), out.end());
+}
+
+// cost of merging b into a, or false if the edge is to be kept
+bool Simplifier::evaluate(int a, int b, Collapse& collapse) const
+{
+    if (boundary[a] && boundary[b])
+        return false;
+    Quadric q = quadrics[a];
+    q += quadrics[b];
+    double x = 0, y = 0, z = 0;
+    if (boundary[a] || boundary[b]) {
+        QVector3D p = points[boundary[a] ? a : b];
+        x = p.x(); y = p.y(); z = p.z();
+    }
+    else if (!q.optimum(x, y, z)) {
+        QVector3D candidates[3] = { points[a], points[b], (points[a] + points[b]) / 2 };
+        double best = std::numeric_limits<double>::max();
+        for (const QVector3D& p : candidates) {
+            double e = q.error(p.x(), p.y(), p.z());
+            if (e < best) {
+                best = e;
+                x = p.x(); y = p.y(); z = p.z();
+            }
+        }
+    }
+    collapse = { float(qMax(0.0, q.error(x, y, z))), a, b,
+                 float(x), float(y), float(z) };
+    return true;
+}
+
+// whether the collapse keeps the surface a manifold without folds
+bool Simplifier::isValid(const Collapse& collapse) const
+{
+    const int a = collapse.a, b = collapse.b;
+
+    // an interior edge may only have its two triangles' apexes in common
+    const int* na = neighbours.constData() + neighbourOffsets[a];
+    const int* nb = neighbours.constData() + neighbourOffsets[b];
+    const int* naEnd = neighbours.constData() + neighbourOffsets[a + 1];
+    const int* nbEnd = neighbours.constData() + neighbourOffsets[b + 1];
+    int common = 0;
+    while (na < naEnd && nb < nbEnd)
+        if (*na < *nb) na++;
+        else if (*nb < *na) nb++;
+        else { common++; na++; nb++; }
+    if (common != 2)
+        return false;
+
+    // no remaining triangle may flip
+    const QVector3D target(collapse.x, collapse.y, collapse.z);
+    for (int v : { a, b })
+        for (int k = vertexOffsets[v]; k < vertexOffsets[v + 1]; k++) {
+            const int* t = tris.constData() + 3 * vertexTris[k];
+            QVector3D before[3], after[3];
+            int shared = 0;
+            for (int j = 0; j < 3; j++) {
+                before[j] = after[j] = points[t[j]];
+                if (t[j] == a || t[j] == b) {
+                    after[j] = target;
+                    shared++;
+                }
+            }
+            if (shared == 2)
+                continue;
+            QVector3D n0 = normal(before[0], before[1], before[2]);
+            QVector3D n1 = normal(after[0], after[1], after[2]);
+            if (QVector3D::dotProduct(n0, n1) <= 0)
+                return false;
+        }
+    return true;
+}
+
+// every edge once, from its lower-numbered end
+QVector<Collapse> Simplifier::evaluate() const
+{
+    const int chunks = threadCount() * 4;
+    QVector<QVector<Collapse> > found(chunks);
+    parallelFor(chunks, [&](int begin, int end) {
+        for (int c = begin; c < end; c++) {
+            int first = int(qint64(points.size()) * c / chunks);
+            int last = int(qint64(points.size()) * (c + 1) / chunks);
+            for (int v = first; v < last; v++) {
+                for (int k = neighbourOffsets[v]; k < neighbourOffsets[v + 1]; k++) {
+                    int u = neighbours[k];
+                    if (u <= v)
+                        continue;
+                    Collapse collapse;
+                    if (evaluate(v, u, collapse))
+                        found[c].push_back(collapse);
+                }
+            }
+        }
+    }, 1);
+    QVector<Collapse> collapses;
+    for (const auto& part : qAsConst(found))
+        collapses += part;
+    return collapses;
+}
+
+// keeps the cheapest valid collapses whose triangles do not overlap, so
+// that they can all be applied at once
+void Simplifier::select(QVector<Collapse>& collapses, int budget) const
+{
+    // costs are not negative, so their bit patterns sort like the values;
+    // a byte-wise radix sort over them is far cheaper than comparisons
+    QVector<quint32> keys(collapses.size());
+    QVector<int> order(collapses.size()), swap(collapses.size());
+    for (int i = 0; i < collapses.size(); i++) {
+        memcpy(&keys[i], &collapses[i].cost, 4);
+        order[i] = i;
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+        int start[257] = {};
+        for (int i : qAsConst(order))
+            start[(keys[i] >> shift & 0xFF) + 1]++;
+        std::partial_sum(start, start + 257, start);
+        for (int i : qAsConst(order))
+            swap[start[keys[i] >> shift & 0xFF]++] = i;
+        std::swap(order, swap);
+    }
+
+    // two collapses share a triangle exactly when one of them has an end
+    // next to an end of the other, so the ends and their neighbours are
+    // locked by every collapse taken
+    QVector<char> locked(points.size(), 0);
+    QVector<Collapse> chosen;
+    for (int i : qAsConst(order)) {
+        if (chosen.size() == budget)
+            break;
+        const Collapse& c = collapses[i];
+        if (locked[c.a] || locked[c.b] || !isValid(c))
+            continue;
+        for (int v : { c.a, c.b }) {
+            locked[v] = 1;
+            for (int k = neighbourOffsets[v]; k < neighbourOffsets[v + 1]; k++)
+                locked[neighbours[k]] = 1;
+        }
+        chosen.push_back(c);
+    }
+    collapses = chosen;
+}
+
+void Simplifier::apply(const QVector<Collapse>& collapses)
+{
+    QVector<int> remap(points.size());
+    std::iota(remap.begin(), remap.end(), 0);
+    for (const Collapse& c : collapses) {
+        points.set(c.a, QVector3D(c.x, c.y, c.z));
+        quadrics[c.a] += quadrics[c.b];
+        remap[c.b] = c.a;
+    }
+
+    // drop the triangles that lost a corner
+    int kept = 0;
+    for (int t = 0; t < triangleCount(); t++) {
+        int v[3] = { remap[tris[3 * t]], remap[tris[3 * t + 1]], remap[tris[3 * t + 2]] };
+        if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+            continue;
+        for (int j = 0; j < 3; j++)
+            tris[3 * kept + j] = v[j];
+        colors[kept++] = colors[t];
+    }
+    tris.resize(3 * kept);
+    colors.resize(kept);
+
+    // renumber the vertices still in use
+    QVector<int> renumber(points.size(), -1);
+    for (int v : qAsConst(tris))
+        renumber[v] = 0;
+    int used = 0;
+    for (int v = 0; v < points.size(); v++)
+        if (renumber[v] == 0) {
+            renumber[v] = used;
+            points.set(used, points[v]);
+            quadrics[used++] = quadrics[v];
+        }
+    points.resize(used);
+    quadrics.resize(used);
+    int* corner = tris.data();
+    parallelFor(tris.size(), [&](int begin, int end) {
+        for (int k = begin; k < end; k++)
+            corner[k] = renumber[corner[k]];
+    });
+    buildAdjacency();
+}
+
+bool Simplifier::reduceTo(int triangles)
+{
+    while (triangleCount() > triangles) {
+        QVector<Collapse> collapses = evaluate();
+        // an interior collapse removes two triangles
+        select(collapses, (triangleCount() - triangles + 1) / 2);
+        if (collapses.isEmpty())
+            return false;
+        apply(collapses);
+    }
+    return true;
+}
+
+Polyhedron Simplifier::toPolyhedron(float normalLength) const
+{
+    Polyhedron mesh;
+    mesh.points = points;
+    mesh.indices = tris;
+    mesh.offsets.resize(triangleCount() + 1);
+    for (int i = 0; i < mesh.offsets.size(); i++)
+        mesh.offsets[i] = 3 * i;
+    mesh.colors = colors;
+    mesh.buildNormals(normalLength);
+    mesh.buildAdjacency();
+    return mesh;
+}
+
+} // namespace
+
+QVector<Polyhedron> simplifyLevels(const Polyhedron& mesh, int minPolygons)
+{
+    QVector<Polyhedron> levels;
+    const float normalLength = mesh.normals.size() ? mesh.normals[0].length() : 1;
+    Simplifier simplifier(mesh);
+    int previous = mesh.polygonCount();
+    for (int target = simplifier.triangleCount() / 4; target >= minPolygons; target /= 4) {
+        bool isReached = simplifier.reduceTo(target);
+        // a level is only worth keeping if it is clearly coarser
+        if (simplifier.triangleCount() > previous * 3 / 4)
+            break;
+        levels.push_back(simplifier.toPolyhedron(normalLength));
+        previous = simplifier.triangleCount();
+        if (!isReached)
+            break;
+    }
+    return levels;
+}
@@ -0,0 +1,18 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include "polyhedron.h"
+
+// Garland-Heckbert quadric error simplification. Polygons are split into
+// triangles, which keep the colors of the polygons they came from.
+// Collapses run in rounds: every round the collapse costs of all edges are
+// evaluated in parallel and the cheapest collapses that touch disjoint
+// triangles are applied together.
+
+// Successively coarser versions of mesh, each with about a quarter of the
+// triangles of the one before, while they stay above minPolygons. The
+// levels come with normals of the same length as those of mesh and with
+// adjacency built.
+QVector<Polyhedron> simplifyLevels(const Polyhedron& mesh, int minPolygons = 1000);
+
+#endif // SIMPLIFY_H
@@ -0,0 +1,180 @@
+#include "transform.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define HAVE_SSE2
+#if defined(__GNUC__)
+#define HAVE_AVX2
+#endif
+#endif
+
+namespace {
+
+// Upper three rows of the matrix; the last one of an affine transform is
+// (0, 0, 0, 1) and is never needed
+struct Kernel
+{
+    float m[3][4];
+    const float *x, *y, *z;
+    float *ox, *oy, *oz;
+    quint64 *backfaces; // null when no flags are wanted
+};
+
+Kernel makeKernel(const QMatrix4x4& m, float w, const Coords& in, Coords& out)
+{
+    Kernel k;
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++)
+            k.m[r][c] = m(r, c);
+        k.m[r][3] = m(r, 3) * w;
+    }
+    out.resize(in.size());
+    k.x = in.x.constData();  k.y = in.y.constData();  k.z = in.z.constData();
+    k.ox = out.x.data();     k.oy = out.y.data();     k.oz = out.z.data();
+    k.backfaces = nullptr;
+    return k;
+}
+
+void runScalar(const Kernel& k, int begin, int end)
+{
+    for (int i = begin; i < end; i++) {
+        float x = k.x[i], y = k.y[i], z = k.z[i];
+        k.ox[i] = k.m[0][0] * x + k.m[0][1] * y + k.m[0][2] * z + k.m[0][3];
+        k.oy[i] = k.m[1][0] * x + k.m[1][1] * y + k.m[1][2] * z + k.m[1][3];
+        k.oz[i] = k.m[2][0] * x + k.m[2][1] * y + k.m[2][2] * z + k.m[2][3];
+        if (k.backfaces && k.oz[i] >= 0)
+            k.backfaces[i >> 6] |= quint64(1) << (i & 63);
+    }
+}
+
+#ifdef HAVE_SSE2
+// 4 elements per step; steps never straddle a 64-bit mask word as long
+// as begin is a multiple of 4
+int runSse2(const Kernel& k, int begin, int end)
+{
+    __m128 m[3][4];
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 4; c++)
+            m[r][c] = _mm_set1_ps(k.m[r][c]);
+    const __m128 zero = _mm_setzero_ps();
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(k.x + i);
+        __m128 y = _mm_loadu_ps(k.y + i);
+        __m128 z = _mm_loadu_ps(k.z + i);
+        __m128 o[3];
+        for (int r = 0; r < 3; r++)
+            o[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[r][0], x),
+                                         _mm_mul_ps(m[r][1], y)),
+                              _mm_add_ps(_mm_mul_ps(m[r][2], z), m[r][3]));
+        _mm_storeu_ps(k.ox + i, o[0]);
+        _mm_storeu_ps(k.oy + i, o[1]);
+        _mm_storeu_ps(k.oz + i, o[2]);
+        if (k.backfaces) {
+            quint64 bits = _mm_movemask_ps(_mm_cmpge_ps(o[2], zero));
+            k.backfaces[i >> 6] |= bits << (i & 63);
+        }
+    }
+    return i;
+}
+#endif
+
+#ifdef HAVE_AVX2
+// 8 elements per step, selected at run time
+__attribute__((target("avx2,fma")))
+int runAvx2(const Kernel& k, int begin, int end)
+{
+    __m256 m[3][4];
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 4; c++)
+            m[r][c] = _mm256_set1_ps(k.m[r][c]);
+    const __m256 zero = _mm256_setzero_ps();
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(k.x + i);
+        __m256 y = _mm256_loadu_ps(k.y + i);
+        __m256 z = _mm256_loadu_ps(k.z + i);
+        __m256 o[3];
+        for (int r = 0; r < 3; r++)
+            o[r] = _mm256_fmadd_ps(m[r][0], x,
+                   _mm256_fmadd_ps(m[r][1], y,
+                   _mm256_fmadd_ps(m[r][2], z, m[r][3])));
+        _mm256_storeu_ps(k.ox + i, o[0]);
+        _mm256_storeu_ps(k.oy + i, o[1]);
+        _mm256_storeu_ps(k.oz + i, o[2]);
+        if (k.backfaces) {
+            quint64 bits = _mm256_movemask_ps(
+                        _mm256_cmp_ps(o[2], zero, _CMP_GE_OQ));
+            k.backfaces[i >> 6] |= bits << (i & 63);
+        }
+    }
+    return i;
+}
+
+bool hasAvx2()
+{
+    static const bool has = __builtin_cpu_supports("avx2")
+                         && __builtin_cpu_supports("fma");
+    return has;
+}
+#endif
+
+void run(const Kernel& k, int begin, int end)
+{
+    int done = begin;
+#if defined(HAVE_AVX2)
+    done = hasAvx2() ? runAvx2(k, begin, end) : runSse2(k, begin, end);
+#elif defined(HAVE_SSE2)
+    done = runSse2(k, begin, end);
+#endif
+    runScalar(k, done, end);
+}
+
+// full mask words go through the vector kernels, the rest one by one
+void run(const Kernel& k, int n, const BitMask& subset)
+{
+    for (int w = 0; w < subset.words.size(); w++) {
+        quint64 bits = subset.words[w];
+        if (bits == ~quint64(0)) {
+            run(k, w * 64, qMin(w * 64 + 64, n));
+            continue;
+        }
+        for (; bits; bits &= bits - 1) {
+            int i = w * 64 + int(qCountTrailingZeroBits(bits));
+            runScalar(k, i, i + 1);
+        }
+    }
+}
+
+} // namespace
+
+void transformPoints(const QMatrix4x4& m, const Coords& in, Coords& out)
+{
+    Kernel k = makeKernel(m, 1, in, out);
+    run(k, 0, in.size());
+}
+
+void transformPoints(const QMatrix4x4& m, const Coords& in, Coords& out,
+                     const BitMask& subset)
+{
+    Kernel k = makeKernel(m, 1, in, out);
+    run(k, in.size(), subset);
+}
+
+void transformNormals(const QMatrix4x4& m, const Coords& in, Coords& out,
+                      BitMask& backfaces)
+{
+    Kernel k = makeKernel(m, 0, in, out);
+    backfaces.reset(in.size());
+    k.backfaces = backfaces.words.data();
+    run(k, 0, in.size());
+}
+
+void transformNormals(const QMatrix4x4& m, const Coords& in, Coords& out,
+                      BitMask& backfaces, const BitMask& subset)
+{
+    Kernel k = makeKernel(m, 0, in, out);
+    backfaces.reset(in.size());
+    k.backfaces = backfaces.words.data();
+    run(k, in.size(), subset);
+}
@@ -0,0 +1,63 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <QMatrix4x4>
+#include <QtAlgorithms>
+#include "polyhedron.h"
+
+// One bit per polygon
+struct BitMask
+{
+    QVector<quint64> words;
+    void reset(int n) { words.fill(0, (n + 63) / 64); }
+    bool test(int i) const { return words[i >> 6] >> (i & 63) & 1; }
+    void set(int i) { words[i >> 6] |= quint64(1) << (i & 63); }
+    // sets the first n bits
+    void fill(int n);
+    int count() const;
+    // calls f(i) for every set bit in ascending order
+    template <typename F> void forEach(F f) const;
+};
+
+inline void BitMask::fill(int n)
+{
+    words.fill(~quint64(0), (n + 63) / 64);
+    if (n & 63)
+        words.last() = (quint64(1) << (n & 63)) - 1;
+}
+
+inline int BitMask::count() const
+{
+    int n = 0;
+    for (quint64 w : words)
+        n += qPopulationCount(w);
+    return n;
+}
+
+template <typename F>
+void BitMask::forEach(F f) const
+{
+    for (int w = 0; w < words.size(); w++)
+        for (quint64 bits = words[w]; bits; bits &= bits - 1)
+            f(w * 64 + int(qCountTrailingZeroBits(bits)));
+}
+
+// out = m * (p, 1) for every point; m is expected to be affine
+void transformPoints(const QMatrix4x4& m, const Coords& in, Coords& out);
+
+// the same restricted to the points in subset; the others are left as
+// they were
+void transformPoints(const QMatrix4x4& m, const Coords& in, Coords& out,
+                     const BitMask& subset);
+
+// out = m * (n, 0) for every normal, flagging in backfaces the polygons
+// whose transformed normal does not face the viewer (z >= 0)
+void transformNormals(const QMatrix4x4& m, const Coords& in, Coords& out,
+                      BitMask& backfaces);
+
+// the same restricted to the normals in subset; no polygon outside it is
+// flagged
+void transformNormals(const QMatrix4x4& m, const Coords& in, Coords& out,
+                      BitMask& backfaces, const BitMask& subset);
+
+#endif // TRANSFORM_H
@@ -0,0 +1,464 @@
+#include "vectorexport.h"
+#include <QFileInfo>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPair>
+#include <QPdfWriter>
+#include <QSaveFile>
+#include <QTextStream>
+#include <cmath>
+
+namespace {
+
+// pieces smaller than this, in square pixels, are dropped
+const double minArea = 1e-4;
+// how much nearer a face must be to hide anything
+const double depthBias = 1e-3;
+
+bool fail(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+
+// a x + b y + c >= 0
+struct HalfPlane
+{
+    double a, b, c;
+    double at(const QPointF& p) const { return a * p.x() + b * p.y() + c; }
+};
+
+// the side of the line through p and q that a counterclockwise polygon
+// with the edge pq lies on
+HalfPlane leftOf(const QPointF& p, const QPointF& q)
+{
+    double a = p.y() - q.y(), b = q.x() - p.x();
+    return { a, b, -(a * p.x() + b * p.y()) };
+}
+
+double area(const QPolygonF& poly)
+{
+    double sum = 0;
+    for (int j = 0, k = poly.size() - 1; j < poly.size(); k = j++)
+        sum += poly[k].x() * poly[j].y() - poly[j].x() * poly[k].y();
+    return std::abs(sum) / 2;
+}
+
+// Cuts the convex polygon along the line of h into the parts on either
+// side of it, one Sutherland-Hodgman step for both at once
+void split(const QPolygonF& poly, const HalfPlane& h, QPolygonF& inside,
+           QPolygonF& outside)
+{
+    inside.clear();
+    outside.clear();
+    for (int j = 0, k = poly.size() - 1; j < poly.size(); k = j++) {
+        const QPointF &p = poly[k], &q = poly[j];
+        const double dp = h.at(p), dq = h.at(q);
+        if ((dp >= 0) != (dq >= 0)) {
+            QPointF x = p + (q - p) * (dp / (dp - dq));
+            inside.push_back(x);
+            outside.push_back(x);
+        }
+        (dq >= 0 ? inside : outside).push_back(q);
+    }
+}
+
+// the part of the convex polygon inside all the half planes
+void clip(QPolygonF& poly, const HalfPlane* planes, int count)
+{
+    QPolygonF inside, outside;
+    for (int k = 0; k < count && poly.size() >= 3; k++) {
+        split(poly, planes[k], inside, outside);
+        poly.swap(inside);
+    }
+}
+
+// Appends to out what is left of piece once its part inside all the half
+// planes is taken away, as up to one convex piece per plane. Returns
+// false, appending nothing, when that part has next to no area, which is
+// the case for most neighbours of a face.
+bool subtract(const QPolygonF& piece, const HalfPlane* planes, int count,
+              QVector<QPolygonF>& out)
+{
+    QPolygonF hidden = piece;
+    clip(hidden, planes, count);
+    if (hidden.size() < 3 || area(hidden) < minArea)
+        return false;
+    QPolygonF rest = piece, inside, outside;
+    for (int k = 0; k < count; k++) {
+        split(rest, planes[k], inside, outside);
+        if (outside.size() >= 3 && area(outside) >= minArea)
+            out.push_back(outside);
+        rest.swap(inside);
+    }
+    return true;
+}
+
+// The parameters [t0, t1] of the segment from a to b inside all the half
+// planes, each given by its value at a and at b; false if there are none
+bool clipSegment(const double* atA, const double* atB, int count,
+                 double& t0, double& t1)
+{
+    t0 = 0;
+    t1 = 1;
+    for (int k = 0; k < count; k++) {
+        if (atA[k] < 0 && atB[k] < 0)
+            return false;
+        if (atA[k] >= 0 && atB[k] >= 0)
+            continue;
+        double t = atA[k] / (atA[k] - atB[k]);
+        if (atA[k] < 0)
+            t0 = qMax(t0, t);
+        else
+            t1 = qMin(t1, t);
+    }
+    return t0 < t1;
+}
+
+// A triangle of a face, counterclockwise, with its depth as a plane over
+// the screen
+struct Triangle
+{
+    QPointF p[3];
+    double dzdx, dzdy, z0;
+    QRectF box;
+    int polygon;
+
+    double depth(const QPointF& x) const { return dzdx * x.x() + dzdy * x.y() + z0; }
+};
+
+// Triangles listed under every cell of a uniform grid their boxes reach
+// into
+class Grid
+{
+public:
+    explicit Grid(const QVector<Triangle>& triangles)
+    {
+        for (const Triangle& t : triangles)
+            bounds = bounds.isNull() ? t.box : bounds.united(t.box);
+        side = qBound(1, int(std::sqrt(triangles.size() / 2.0)), 512);
+        first.fill(0, side * side + 1);
+        for (const Triangle& t : triangles)
+            forEachCell(t.box, [&](int cell) { first[cell + 1]++; });
+        std::partial_sum(first.begin(), first.end(), first.begin());
+        items.resize(first.last());
+        QVector<int> fill = first;
+        for (int i = 0; i < triangles.size(); i++)
+            forEachCell(triangles[i].box, [&](int cell) { items[fill[cell]++] = i; });
+    }
+
+    // calls f(i) once for every triangle i listed near box; stamps has
+    // an entry per triangle and stamp must differ from call to call
+    template <typename F>
+    void forEachNear(const QRectF& box, QVector<int>& stamps, int stamp, F f) const
+    {
+        forEachCell(box, [&](int cell) {
+            for (int k = first[cell]; k < first[cell + 1]; k++)
+                if (stamps[items[k]] != stamp) {
+                    stamps[items[k]] = stamp;
+                    f(items[k]);
+                }
+        });
+    }
+
+private:
+    template <typename F>
+    void forEachCell(const QRectF& box, F f) const
+    {
+        auto cell = [&](double x, double lo, double size) {
+            return size > 0 ? qBound(0, int((x - lo) / size * side), side - 1) : 0;
+        };
+        int x0 = cell(box.left(), bounds.left(), bounds.width());
+        int x1 = cell(box.right(), bounds.left(), bounds.width());
+        int y0 = cell(box.top(), bounds.top(), bounds.height());
+        int y1 = cell(box.bottom(), bounds.top(), bounds.height());
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                f(y * side + x);
+    }
+
+    QRectF bounds;
+    int side;
+    QVector<int> first;
+    QVector<int> items;
+};
+
+QRectF boxOf(const QPointF& a, const QPointF& b, const QPointF& c)
+{
+    return QRectF(QPointF(qMin(a.x(), qMin(b.x(), c.x())), qMin(a.y(), qMin(b.y(), c.y()))),
+                  QPointF(qMax(a.x(), qMax(b.x(), c.x())), qMax(a.y(), qMax(b.y(), c.y()))));
+}
+
+// shortest text for a coordinate to a hundredth of a pixel
+QString number(double v)
+{
+    return QString::number(std::round(v * 100) / 100);
+}
+
+} // namespace
+
+void addVisibleSurfaces(VectorPicture& picture, const Polyhedron& mesh,
+                        const Coords& screen, const BitMask& front,
+                        const QVector<QRgb>& colors, bool isDrawingEdges,
+                        const QRectF& rect, const QPointF& offset)
+{
+    auto at = [&](int v) { return QPointF(screen.x[v], screen.y[v]); };
+
+    // faces seen edge-on neither show nor hide anything
+    QVector<Triangle> triangles;
+    front.forEach([&](int i) {
+        const int* vs = mesh.polygon(i);
+        for (int j = 1; j + 1 < mesh.polygonSize(i); j++) {
+            int a = vs[0], b = vs[j], c = vs[j + 1];
+            double area2 = (screen.x[b] - screen.x[a]) * (screen.y[c] - screen.y[a])
+                         - (screen.y[b] - screen.y[a]) * (screen.x[c] - screen.x[a]);
+            if (std::abs(area2) < 1e-9)
+                continue;
+            if (area2 < 0) {
+                std::swap(b, c);
+                area2 = -area2;
+            }
+            const double ax = screen.x[a], ay = screen.y[a], az = screen.z[a];
+            Triangle t;
+            t.p[0] = at(a);
+            t.p[1] = at(b);
+            t.p[2] = at(c);
+            t.dzdx = ((screen.z[b] - az) * (screen.y[c] - ay)
+                    - (screen.z[c] - az) * (screen.y[b] - ay)) / area2;
+            t.dzdy = ((screen.z[c] - az) * (screen.x[b] - ax)
+                    - (screen.z[b] - az) * (screen.x[c] - ax)) / area2;
+            t.z0 = az - t.dzdx * ax - t.dzdy * ay;
+            t.box = boxOf(t.p[0], t.p[1], t.p[2]);
+            t.polygon = i;
+            triangles.push_back(t);
+        }
+    });
+    if (triangles.isEmpty())
+        return;
+    const Grid grid(triangles);
+    const HalfPlane bounds[4] = {
+        { 1, 0, -rect.left() }, { -1, 0, rect.right() },
+        { 0, 1, -rect.top() }, { 0, -1, rect.bottom() },
+    };
+
+    // Every triangle loses, to every other one in front of part of it,
+    // the part inside that one's edges and on the near side of the line
+    // where the two planes cross. Most lose nothing and are marked intact.
+    QVector<QVector<QPolygonF>> fragments(colors.isEmpty() ? 0 : triangles.size());
+    QVector<char> intact(fragments.size(), 0);
+    QVector<QPolygonF>* fragmentsOf = fragments.data();
+    char* isIntact = intact.data();
+    parallelFor(fragments.size(), [&](int begin, int end) {
+        QVector<int> stamps(triangles.size(), -1);
+        QVector<QPolygonF> pieces, next;
+        for (int s = begin; s < end; s++) {
+            const Triangle& subject = triangles[s];
+            pieces = { QPolygonF(QVector<QPointF>{ subject.p[0], subject.p[1], subject.p[2] }) };
+            isIntact[s] = 1;
+            grid.forEachNear(subject.box, stamps, s, [&](int o) {
+                const Triangle& occluder = triangles[o];
+                if (pieces.isEmpty() || occluder.polygon == subject.polygon
+                 || !occluder.box.intersects(subject.box))
+                    return;
+                HalfPlane planes[4] = {
+                    leftOf(occluder.p[0], occluder.p[1]),
+                    leftOf(occluder.p[1], occluder.p[2]),
+                    leftOf(occluder.p[2], occluder.p[0]),
+                    { subject.dzdx - occluder.dzdx, subject.dzdy - occluder.dzdy,
+                      subject.z0 - occluder.z0 - depthBias },
+                };
+                int count = 4;
+                if (std::abs(planes[3].a) + std::abs(planes[3].b) < 1e-12) {
+                    if (planes[3].c < 0)
+                        return;
+                    count = 3;
+                }
+                next.clear();
+                for (const QPolygonF& piece : qAsConst(pieces))
+                    if (!subtract(piece, planes, count, next))
+                        next.push_back(piece);
+                    else
+                        isIntact[s] = 0;
+                pieces.swap(next);
+            });
+            for (const QPointF& p : subject.p)
+                for (const HalfPlane& h : bounds)
+                    if (h.at(p) < 0)
+                        isIntact[s] = 0;
+            for (QPolygonF& piece : pieces) {
+                clip(piece, bounds, 4);
+                if (piece.size() >= 3 && area(piece) >= minArea)
+                    fragmentsOf[s].push_back(piece.translated(offset));
+            }
+        }
+    }, 256);
+    // a face whose every triangle is intact goes out whole
+    for (int s = 0; s < fragments.size(); ) {
+        const int i = triangles[s].polygon;
+        int end = s;
+        bool isWhole = true;
+        VectorPicture::Area face = { colors.at(i), {} };
+        for (; end < fragments.size() && triangles[end].polygon == i; end++) {
+            isWhole = isWhole && intact[end];
+            face.pieces += fragments[end];
+        }
+        if (isWhole && end - s == mesh.polygonSize(i) - 2) {
+            QPolygonF whole;
+            for (int j = 0; j < mesh.polygonSize(i); j++)
+                whole.push_back(at(mesh.polygon(i)[j]) + offset);
+            face.pieces = { whole };
+        }
+        if (!face.pieces.isEmpty())
+            picture.areas.push_back(face);
+        s = end;
+    }
+    if (!isDrawingEdges)
+        return;
+
+    // Edges are cut the same way, by the faces they do not belong to.
+    // Those between a front and a back face, or on the border of a front
+    // one, are silhouettes.
+    QVector<QVector<QLineF>> lines(mesh.edges.size()), silhouettes(mesh.edges.size());
+    QVector<QLineF>* linesOf = lines.data();
+    QVector<QLineF>* silhouettesOf = silhouettes.data();
+    parallelFor(mesh.edges.size(), [&](int begin, int end) {
+        QVector<int> stamps(triangles.size(), -1);
+        QVector<QPair<double, double>> visible, next;
+        for (int e = begin; e < end; e++) {
+            const Edge& edge = mesh.edges[e];
+            const int p0 = edge.polygons[0], p1 = edge.polygons[1];
+            const bool isFront0 = front.test(p0), isFront1 = p1 >= 0 && front.test(p1);
+            if (!isFront0 && !isFront1)
+                continue;
+            const int va = edge.vertices[0], vb = edge.vertices[1];
+            const QPointF a = at(va), b = at(vb);
+            visible = { { 0.0, 1.0 } };
+            grid.forEachNear(QRectF(a, b).normalized(), stamps, e, [&](int o) {
+                const Triangle& occluder = triangles[o];
+                if (visible.isEmpty() || occluder.polygon == p0 || occluder.polygon == p1)
+                    return;
+                double atA[4], atB[4], t0, t1;
+                for (int k = 0; k < 3; k++) {
+                    HalfPlane h = leftOf(occluder.p[k], occluder.p[(k + 1) % 3]);
+                    atA[k] = h.at(a);
+                    atB[k] = h.at(b);
+                }
+                atA[3] = screen.z[va] - occluder.depth(a) - depthBias;
+                atB[3] = screen.z[vb] - occluder.depth(b) - depthBias;
+                if (!clipSegment(atA, atB, 4, t0, t1) || t1 - t0 < 1e-6)
+                    return;
+                next.clear();
+                for (const auto& span : qAsConst(visible)) {
+                    if (span.first < t0)
+                        next.push_back({ span.first, qMin(span.second, t0) });
+                    if (span.second > t1)
+                        next.push_back({ qMax(span.first, t1), span.second });
+                }
+                visible.swap(next);
+            });
+            QVector<QLineF>& out = (isFront0 != isFront1 ? silhouettesOf : linesOf)[e];
+            for (const auto& span : qAsConst(visible)) {
+                QPointF from = a + (b - a) * span.first, to = a + (b - a) * span.second;
+                double atA[4], atB[4], t0, t1;
+                for (int k = 0; k < 4; k++) {
+                    atA[k] = bounds[k].at(from);
+                    atB[k] = bounds[k].at(to);
+                }
+                if (clipSegment(atA, atB, 4, t0, t1))
+                    out.push_back(QLineF(from + (to - from) * t0 + offset,
+                                              from + (to - from) * t1 + offset));
+            }
+        }
+    }, 256);
+    for (int e = 0; e < lines.size(); e++) {
+        picture.lines += lines[e];
+        picture.silhouettes += silhouettes[e];
+    }
+}
+
+bool writeVectorPicture(const VectorPicture& picture, const QString& fileName,
+                        QString* error)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    // Pieces of one color go out as one path. They are outlined in their
+    // own color as well, so that no background shows through the seams
+    // between neighbouring pieces where a viewer antialiases them.
+    const double seam = 0.5;
+
+    if (suffix == "svg") {
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return fail(error, file.errorString());
+        QTextStream out(&file);
+        const QString width = QString::number(picture.size.width());
+        const QString height = QString::number(picture.size.height());
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width
+            << "\" height=\"" << height << "\" viewBox=\"0 0 " << width << ' '
+            << height << "\">\n";
+        for (int i = 0; i < picture.areas.size(); ) {
+            const QRgb rgb = picture.areas[i].color;
+            const QString color = QColor(rgb).name();
+            out << "<path fill=\"" << color << "\" stroke=\"" << color
+                << "\" stroke-width=\"" << seam << "\" stroke-linejoin=\"round\" d=\"";
+            for (; i < picture.areas.size() && picture.areas[i].color == rgb; i++)
+                for (const QPolygonF& piece : picture.areas[i].pieces) {
+                    out << 'M' << number(piece[0].x()) << ' ' << number(piece[0].y()) << 'L';
+                    for (int k = 1; k < piece.size(); k++)
+                        out << (k > 1 ? " " : "") << number(piece[k].x()) << ' '
+                            << number(piece[k].y());
+                    out << 'Z';
+                }
+            out << "\"/>\n";
+        }
+        auto writeLines = [&](const QVector<QLineF>& lines, int width) {
+            if (lines.isEmpty())
+                return;
+            out << "<path fill=\"none\" stroke=\"#000000\" stroke-width=\"" << width
+                << "\" stroke-linecap=\"round\" d=\"";
+            for (const QLineF& line : lines)
+                out << 'M' << number(line.x1()) << ' ' << number(line.y1())
+                    << 'L' << number(line.x2()) << ' ' << number(line.y2());
+            out << "\"/>\n";
+        };
+        writeLines(picture.lines, 1);
+        writeLines(picture.silhouettes, 2);
+        out << "</svg>\n";
+        out.flush();
+        if (!file.commit())
+            return fail(error, file.errorString());
+        return true;
+    }
+
+    if (suffix == "pdf") {
+        QPdfWriter writer(fileName);
+        writer.setResolution(72);
+        writer.setPageSize(QPageSize(QSizeF(picture.size), QPageSize::Point));
+        writer.setPageMargins(QMarginsF());
+        QPainter painter;
+        if (!painter.begin(&writer))
+            return fail(error, QStringLiteral("Cannot write %1").arg(fileName));
+        painter.setRenderHints(QPainter::Antialiasing);
+        for (int i = 0; i < picture.areas.size(); ) {
+            const QRgb color = picture.areas[i].color;
+            QPainterPath path;
+            for (; i < picture.areas.size() && picture.areas[i].color == color; i++)
+                for (const QPolygonF& piece : picture.areas[i].pieces) {
+                    path.addPolygon(piece);
+                    path.closeSubpath();
+                }
+            painter.setPen(QPen(QColor(color), seam, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+            painter.setBrush(QColor(color));
+            painter.drawPath(path);
+        }
+        painter.setPen(QPen(Qt::GlobalColor::black, 1));
+        painter.drawLines(picture.lines);
+        painter.setPen(QPen(Qt::GlobalColor::black, 2));
+        painter.drawLines(picture.silhouettes);
+        painter.end();
+        return true;
+    }
+
+    return fail(error, QStringLiteral("Unknown image format: %1").arg(suffix));
+}
@@ -0,0 +1,48 @@
+#ifndef VECTOREXPORT_H
+#define VECTOREXPORT_H
+
+#include <QColor>
+#include <QLineF>
+#include <QPolygonF>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+#include "polyhedron.h"
+#include "transform.h"
+
+// A drawing made only of what can be seen: areas that never overlap one
+// another, and lines over them
+struct VectorPicture
+{
+    struct Area
+    {
+        QRgb color;
+        QVector<QPolygonF> pieces;  // convex, but for whole faces
+    };
+    QSize size;
+    QVector<Area> areas;
+    QVector<QLineF> lines;
+    QVector<QLineF> silhouettes;    // drawn twice as wide
+};
+
+// Adds to picture the parts of the faces of mesh flagged in front that no
+// other of them covers, as convex pieces in the colors of their faces, and
+// the parts of the edges of mesh.edges that no face covers. Each point is
+// given by its x, y on screen and a depth z, smaller being nearer; faces
+// must stay flat in these coordinates, as they do with z / w in
+// perspective. Faces are taken as fans of triangles, every triangle with
+// its own plane, so that exactly the parts nearer than the others are
+// kept whatever the order of the faces, and faces that pierce or overlap
+// each other in a cycle come out right. With no colors only the edges
+// are added. Everything is cut to rect and then moved by offset.
+void addVisibleSurfaces(VectorPicture& picture, const Polyhedron& mesh,
+                        const Coords& screen, const BitMask& front,
+                        const QVector<QRgb>& colors, bool isDrawingEdges,
+                        const QRectF& rect, const QPointF& offset);
+
+// Writes picture as SVG or PDF, choosing the format by extension; returns
+// false and sets error when the file cannot be written
+bool writeVectorPicture(const VectorPicture& picture, const QString& fileName,
+                        QString* error = nullptr);
+
+#endif // VECTOREXPORT_H
@@ -0,0 +1,457 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include "../Polyhedron/hull.h"
+#include "../Polyhedron/lineraster.h"
+#include "../Polyhedron/meshimport.h"
+#include "../Polyhedron/simplify.h"
+#include "../Polyhedron/transform.h"
+#ifdef Q_OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// The writers below assume a little-endian host.
+
+// Latitude-longitude sphere with 2 * n * n triangles
+static Polyhedron sphere(int n)
+{
+    Polyhedron mesh;
+    for (int i = 0; i <= n; i++)
+        for (int j = 0; j < n; j++) {
+            double theta = M_PI * i / n, phi = 2 * M_PI * j / n;
+            mesh.addVertex(QVector3D(sin(theta) * cos(phi), cos(theta),
+                                     sin(theta) * sin(phi)));
+        }
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) {
+            int a = i * n + j, b = i * n + (j + 1) % n;
+            mesh.addPolygon({ a, a + n, b + n });
+            mesh.addPolygon({ a, b + n, b });
+        }
+    return mesh;
+}
+
+static void writeStl(const Polyhedron& mesh, const QString& fileName)
+{
+    QFile file(fileName);
+    file.open(QIODevice::WriteOnly);
+    QByteArray record(50, 0);
+    file.write(QByteArray(80, 0));
+    quint32 count = mesh.polygonCount();
+    file.write(reinterpret_cast<const char*>(&count), 4);
+    for (int i = 0; i < mesh.polygonCount(); i++) {
+        for (int k = 0; k < 3; k++) {
+            QVector3D p = mesh.points[mesh.polygon(i)[k]];
+            for (int c = 0; c < 3; c++) {
+                float f = p[c];
+                memcpy(record.data() + 12 + 12 * k + 4 * c, &f, 4);
+            }
+        }
+        file.write(record);
+    }
+}
+
+static void writePly(const Polyhedron& mesh, const QString& fileName)
+{
+    QFile file(fileName);
+    file.open(QIODevice::WriteOnly);
+    file.write(QString("ply\nformat binary_little_endian 1.0\n"
+                       "element vertex %1\n"
+                       "property float x\nproperty float y\nproperty float z\n"
+                       "element face %2\n"
+                       "property list uchar int vertex_indices\n"
+                       "end_header\n")
+               .arg(mesh.vertexCount()).arg(mesh.polygonCount()).toLatin1());
+    QByteArray data;
+    data.reserve(mesh.vertexCount() * 12);
+    for (int i = 0; i < mesh.vertexCount(); i++)
+        for (float c : { mesh.points.x[i], mesh.points.y[i], mesh.points.z[i] })
+            data.append(reinterpret_cast<const char*>(&c), 4);
+    file.write(data);
+    data.clear();
+    for (int i = 0; i < mesh.polygonCount(); i++) {
+        data.append(char(3));
+        data.append(reinterpret_cast<const char*>(mesh.polygon(i)), 12);
+    }
+    file.write(data);
+}
+
+static void writeObj(const Polyhedron& mesh, const QString& fileName)
+{
+    QFile file(fileName);
+    file.open(QIODevice::WriteOnly);
+    QTextStream out(&file);
+    out.setRealNumberPrecision(7);
+    for (int i = 0; i < mesh.vertexCount(); i++)
+        out << "v " << mesh.points.x[i] << ' ' << mesh.points.y[i]
+            << ' ' << mesh.points.z[i] << '\n';
+    for (int i = 0; i < mesh.polygonCount(); i++) {
+        const int* vs = mesh.polygon(i);
+        out << "f " << vs[0] + 1 << ' ' << vs[1] + 1 << ' ' << vs[2] + 1 << '\n';
+    }
+}
+
+static void benchImport(QTextStream& out, int triangles)
+{
+    QTemporaryDir dir;
+    int n = qMax(2, int(std::sqrt(triangles / 2.0)));
+    Polyhedron mesh = sphere(n);
+    out << "import: " << mesh.polygonCount() << " triangles, "
+        << threadCount() << " threads" << '\n';
+    struct Format { const char* suffix; void (*write)(const Polyhedron&, const QString&); };
+    for (Format format : { Format{ "stl", writeStl }, Format{ "ply", writePly },
+                           Format{ "obj", writeObj } }) {
+        QString fileName = dir.filePath(QString("sphere.") + format.suffix);
+        format.write(mesh, fileName);
+        Polyhedron loaded;
+        QString error;
+        QElapsedTimer timer;
+        timer.start();
+        bool ok = importMesh(fileName, loaded, &error);
+        qint64 ms = timer.elapsed();
+        out << "  " << format.suffix << ": ";
+        if (ok) {
+            out << ms << " ms, " << loaded.vertexCount() << " vertices, "
+                << loaded.polygonCount() << " polygons";
+            timer.restart();
+            importMesh(fileName, loaded);
+            out << ", " << timer.elapsed() << " ms from cache" << '\n';
+        }
+        else
+            out << "failed: " << error << '\n';
+        out.flush();
+        QFile::remove(fileName);
+        QFile::remove(fileName + ".pmesh");
+    }
+}
+
+static void benchSimplify(QTextStream& out, int triangles)
+{
+    int n = qMax(2, int(std::sqrt(triangles / 2.0)));
+    Polyhedron mesh = sphere(n);
+    mesh.buildNormals(1);
+    out << "simplify: " << mesh.polygonCount() << " triangles, "
+        << threadCount() << " threads" << '\n';
+    QElapsedTimer timer;
+    timer.start();
+    QVector<Polyhedron> levels = simplifyLevels(mesh);
+    out << "  " << timer.elapsed() << " ms for " << levels.size() << " levels:";
+    for (const Polyhedron& level : levels)
+        out << ' ' << level.polygonCount();
+    out << '\n';
+    out.flush();
+}
+
+static void benchHalfEdges(QTextStream& out, int triangles)
+{
+    int n = qMax(2, int(std::sqrt(triangles / 2.0)));
+    Polyhedron mesh = sphere(n);
+    out << "half-edges: " << mesh.polygonCount() << " triangles, "
+        << threadCount() << " threads" << '\n';
+    QElapsedTimer timer;
+    timer.start();
+    mesh.buildHalfEdges();
+    out << "  " << timer.elapsed() << " ms, ";
+    timer.restart();
+    mesh.buildEdges();
+    out << timer.elapsed() << " ms more for " << mesh.edges.size() << " edges" << '\n';
+    mesh.buildAdjacency();
+    timer.restart();
+    Polyhedron smooth = mesh.subdividedLoop(1);
+    out << "  Loop step in " << timer.elapsed() << " ms, "
+        << smooth.polygonCount() << " triangles" << '\n';
+    out.flush();
+}
+
+static void benchPick(QTextStream& out, int triangles)
+{
+    int n = qMax(2, int(std::sqrt(triangles / 2.0)));
+    Polyhedron mesh = sphere(n);
+    QElapsedTimer timer;
+    timer.start();
+    mesh.buildBvh();
+    out << "pick: " << mesh.polygonCount() << " triangles, BVH in "
+        << timer.elapsed() << " ms" << '\n';
+
+    // rays from all around aimed at random points near the centre
+    const int rays = 100000;
+    quint32 seed = 1;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / (1 << 24) * 2 - 1;
+    };
+    QVector<QVector3D> origins(rays), directions(rays);
+    for (int i = 0; i < rays; i++) {
+        origins[i] = QVector3D(random(), random(), random()).normalized() * 3;
+        directions[i] = QVector3D(random(), random(), random()) * 0.5f - origins[i];
+    }
+    int hits = 0;
+    timer.start();
+    for (int i = 0; i < rays; i++) {
+        RayHit hit;
+        hits += mesh.intersect(origins[i], directions[i], hit);
+    }
+    out << "  " << timer.nsecsElapsed() / 1000.0 / rays << " us per ray, "
+        << hits << " of " << rays << " hit" << '\n';
+    out.flush();
+}
+
+static void benchHull(QTextStream& out, int points)
+{
+    out << "hull: " << points << " points, " << threadCount() << " threads" << '\n';
+    quint32 seed = 1;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / (1 << 24) * 2 - 1;
+    };
+    auto gaussian = [&random]() {
+        QVector3D p;
+        for (int c = 0; c < 3; c++) {
+            float u = (random() + 1) / 2, v = random();
+            p[c] = std::sqrt(-2 * std::log(qMax(u, 1e-7f))) * std::cos(float(M_PI) * v);
+        }
+        return p;
+    };
+    struct Distribution { const char* name; int count; std::function<QVector3D()> point; };
+    // every point on the sphere is on the hull, so it gets a tenth of them
+    const Distribution distributions[] = {
+        { "in a ball", points, [&]() {
+              QVector3D p;
+              do p = QVector3D(random(), random(), random());
+              while (p.lengthSquared() > 1);
+              return p;
+          } },
+        { "on a sphere", points / 10, [&]() { return gaussian().normalized(); } },
+        { "gaussian", points, gaussian },
+        { "in a cube", points, [&]() { return QVector3D(random(), random(), random()); } },
+    };
+    for (const Distribution& distribution : distributions) {
+        Coords cloud;
+        cloud.resize(distribution.count);
+        for (int i = 0; i < distribution.count; i++)
+            cloud.set(i, distribution.point());
+        QElapsedTimer timer;
+        timer.start();
+        Polyhedron hull = convexHull(cloud);
+        out << "  " << distribution.name << ", " << distribution.count << " points: "
+            << timer.elapsed() << " ms, " << hull.vertexCount() << " vertices, "
+            << hull.polygonCount() << " triangles" << '\n';
+        out.flush();
+    }
+}
+
+// Hardware cache references and misses of the calling thread, where the
+// kernel lets a user process count them
+class CacheCounters
+{
+public:
+    CacheCounters()
+    {
+#ifdef Q_OS_LINUX
+        group = open(PERF_COUNT_HW_CACHE_REFERENCES, -1);
+        misses = open(PERF_COUNT_HW_CACHE_MISSES, group);
+#endif
+    }
+    ~CacheCounters()
+    {
+#ifdef Q_OS_LINUX
+        if (misses >= 0) close(misses);
+        if (group >= 0) close(group);
+#endif
+    }
+    bool isAvailable() const { return group >= 0 && misses >= 0; }
+    void start()
+    {
+#ifdef Q_OS_LINUX
+        if (!isAvailable())
+            return;
+        ioctl(group, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+    // references and misses since start()
+    void stop(quint64& references, quint64& missed)
+    {
+        references = missed = 0;
+#ifdef Q_OS_LINUX
+        if (!isAvailable())
+            return;
+        ioctl(group, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        if (read(group, &references, sizeof references) != sizeof references
+         || read(misses, &missed, sizeof missed) != sizeof missed)
+            references = missed = 0;
+#endif
+    }
+
+private:
+#ifdef Q_OS_LINUX
+    static int open(quint64 config, int groupFd)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof attr);
+        attr.size = sizeof attr;
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = groupFd < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return int(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+    }
+#endif
+    int group = -1;
+    int misses = -1;
+};
+
+// What a frame does with the mesh: every point and normal transformed,
+// then the corners of every front face gathered from the transformed
+// points, as the painter is handed them
+static double frame(const Polyhedron& mesh, const QMatrix4x4& m, Coords& points,
+                    Coords& normals, BitMask& backfaces)
+{
+    transformPoints(m, mesh.points, points);
+    transformNormals(m, mesh.normals, normals, backfaces);
+    double area = 0;
+    for (int i = 0; i < mesh.polygonCount(); i++) {
+        if (backfaces.test(i))
+            continue;
+        const int* vs = mesh.polygon(i);
+        for (int j = 0, k = mesh.polygonSize(i) - 1; j < mesh.polygonSize(i); k = j++)
+            area += points.x[vs[k]] * points.y[vs[j]] - points.x[vs[j]] * points.y[vs[k]];
+    }
+    return area;
+}
+
+static void benchLocality(QTextStream& out, int triangles)
+{
+    int n = qMax(2, int(std::sqrt(triangles / 2.0)));
+    Polyhedron mesh = sphere(n);
+    // faces and vertices in the arbitrary order of a file off the disk
+    quint32 seed = 1;
+    auto random = [&seed](int below) {
+        seed = seed * 1664525u + 1013904223u;
+        return int(quint64(seed) * below >> 32);
+    };
+    QVector<int> vertexOrder(mesh.vertexCount()), polygonOrder(mesh.polygonCount());
+    std::iota(vertexOrder.begin(), vertexOrder.end(), 0);
+    std::iota(polygonOrder.begin(), polygonOrder.end(), 0);
+    for (int i = vertexOrder.size() - 1; i > 0; i--)
+        std::swap(vertexOrder[i], vertexOrder[random(i + 1)]);
+    for (int i = polygonOrder.size() - 1; i > 0; i--)
+        std::swap(polygonOrder[i], polygonOrder[random(i + 1)]);
+    Polyhedron shuffled;
+    shuffled.points.resize(mesh.vertexCount());
+    for (int v = 0; v < mesh.vertexCount(); v++)
+        shuffled.points.set(vertexOrder[v], mesh.points[v]);
+    for (int i : qAsConst(polygonOrder)) {
+        QVector<int> vs;
+        for (int j = 0; j < mesh.polygonSize(i); j++)
+            vs.push_back(vertexOrder[mesh.polygon(i)[j]]);
+        shuffled.addPolygon(vs);
+    }
+    shuffled.buildNormals(1);
+
+    Polyhedron sorted = shuffled;
+    QElapsedTimer timer;
+    timer.start();
+    sorted.reorderForLocality();
+    sorted.buildNormals(1);
+    out << "locality: " << mesh.polygonCount() << " triangles, reordered in "
+        << timer.elapsed() << " ms" << '\n';
+
+    QMatrix4x4 m;
+    m.rotate(30, { 1, 1, 0 });
+    CacheCounters counters;
+    const int frames = 10;
+    for (const Polyhedron* order : { &shuffled, &sorted }) {
+        Coords points, normals;
+        BitMask backfaces;
+        // the result is kept so that the gathering is not optimised away
+        volatile double sink = frame(*order, m, points, normals, backfaces);
+        quint64 references, misses;
+        timer.restart();
+        counters.start();
+        for (int f = 0; f < frames; f++)
+            sink = sink + frame(*order, m, points, normals, backfaces);
+        counters.stop(references, misses);
+        out << "  " << (order == &sorted ? "reordered" : "as loaded") << ": "
+            << timer.nsecsElapsed() / 1e6 / frames << " ms per frame, ";
+        if (counters.isAvailable() && references > 0)
+            out << misses * 100.0 / references << "% of " << references / frames
+                << " cache references missed";
+        else
+            out << "no cache counters";
+        out << '\n';
+        out.flush();
+    }
+}
+
+static void benchWireframe(QTextStream& out, int triangles)
+{
+    int n = qMax(2, int(std::sqrt(triangles / 2.0)));
+    Polyhedron mesh = sphere(n);
+    mesh.buildEdges();
+    // the edges as the front view of a full HD window shows them
+    QImage image(1920, 1080, QImage::Format_ARGB32_Premultiplied);
+    QVector<QLineF> lines;
+    lines.reserve(mesh.edges.size());
+    for (const auto& e : mesh.edges) {
+        QVector3D a = mesh.points[e.vertices[0]], b = mesh.points[e.vertices[1]];
+        lines.push_back({ QPointF(a.x(), -a.y()) * 500, QPointF(b.x(), -b.y()) * 500 });
+    }
+    out << "wireframe: " << lines.size() << " edges, " << threadCount() << " threads" << '\n';
+
+    QElapsedTimer timer;
+    image.fill(Qt::white);
+    timer.start();
+    QPainter painter(&image);
+    painter.setRenderHints(QPainter::Antialiasing);
+    painter.translate(image.rect().center());
+    painter.setPen(Qt::GlobalColor::black);
+    painter.drawLines(lines);
+    painter.end();
+    out << "  painter: " << timer.elapsed() << " ms" << '\n';
+
+    image.fill(Qt::white);
+    timer.restart();
+    rasterizeLines(image, lines, qRgb(0, 0, 0), image.rect().center(), image.rect());
+    out << "  rasterizer: " << timer.elapsed() << " ms" << '\n';
+
+    // lines a hair off an axis, whose gradient is next to nothing, must
+    // still get ink along all their length
+    QImage strip(1100, 200, QImage::Format_ARGB32_Premultiplied);
+    strip.fill(Qt::transparent);
+    rasterizeLines(strip, { QLineF(10, 100, 1000, 100.00001), QLineF(50, 10, 50.00001, 190) },
+                   qRgb(0, 0, 0), QPointF(), strip.rect());
+    double ink = 0;
+    for (int y = 0; y < strip.height(); y++)
+        for (int x = 0; x < strip.width(); x++)
+            ink += qAlpha(strip.pixel(x, y)) / 255.0;
+    out << "  near-axis lines: " << ink << " pixels of ink for 1170 of length"
+        << (std::abs(ink - 1170) > 2 ? ", FAILED" : "") << '\n';
+    out.flush();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+    int triangles = argc > 1 ? QString(argv[1]).toInt() : 10000000;
+    benchImport(out, triangles);
+    benchSimplify(out, triangles);
+    benchHalfEdges(out, triangles);
+    benchLocality(out, triangles);
+    benchWireframe(out, triangles);
+    benchPick(out, triangles);
+    benchHull(out, triangles);
+    return 0;
+}
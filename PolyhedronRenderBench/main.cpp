@@ -0,0 +1,184 @@
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <cmath>
+#include "../Polyhedron/renderarea.h"
+
+#ifdef POLYHEDRON_NO_STATS
+#error "the benchmark reads the timings from the render statistics"
+#endif
+
+// Renders generated tori of growing size in a RenderArea on an offscreen
+// surface, turning them along a fixed path, under every combination of
+// normal culling, depth sorting, face colours and wireframe, and prints
+// the time every stage took as JSON:
+//
+//     PolyhedronRenderBench [largest face count] [frames] > results.json
+//
+// Every combination is run twice: with the full mesh pinned, so that the
+// stages are timed on every face of it, and at the level of detail
+// RenderArea picks for the window, as in the application. "faces" is how
+// many faces were drawn and "sourceFaces" how many the torus has.
+
+// Torus of about the given number of quads, twice as many around the
+// ring as around the tube
+static Polyhedron torus(int faces)
+{
+    const int V = qMax(3, int(std::sqrt(faces / 2.0))), U = 2 * V;
+    const float R = 1, r = 0.4f;
+    Polyhedron mesh;
+    for (int u = 0; u < U; u++)
+        for (int v = 0; v < V; v++) {
+            double phi = 2 * M_PI * u / U, theta = 2 * M_PI * v / V;
+            double ring = R + r * cos(theta);
+            mesh.addVertex(QVector3D(ring * cos(phi), r * sin(theta), ring * sin(phi)));
+        }
+    for (int u = 0; u < U; u++)
+        for (int v = 0; v < V; v++) {
+            int u1 = (u + 1) % U, v1 = (v + 1) % V;
+            mesh.addPolygon({ u * V + v, u1 * V + v, u1 * V + v1, u * V + v1 });
+        }
+    mesh.buildNormals(1);
+    return mesh;
+}
+
+// Waits for each frame the render thread draws and keeps its numbers
+class FrameRecorder
+{
+public:
+    explicit FrameRecorder(RenderArea& area) : area(area)
+    {
+        QObject::connect(&area, &RenderArea::statsChanged, &loop,
+                         [this](RenderStats stats) { last = stats; loop.quit(); });
+    }
+
+    // paints at once, so that the frame starts now, and waits for it;
+    // something must have changed since the last frame
+    RenderStats render()
+    {
+        area.repaint();
+        loop.exec();
+        return last;
+    }
+
+private:
+    RenderArea& area;
+    QEventLoop loop;
+    RenderStats last;
+};
+
+// mean, least and most of a stage over the frames, in milliseconds
+static QJsonObject timing(const QVector<qint64>& ns)
+{
+    qint64 sum = 0, least = ns.first(), most = ns.first();
+    for (qint64 t : ns) {
+        sum += t;
+        least = qMin(least, t);
+        most = qMax(most, t);
+    }
+    return { { "mean", sum / 1e6 / ns.size() }, { "min", least / 1e6 },
+             { "max", most / 1e6 } };
+}
+
+static QJsonObject run(RenderArea& area, FrameRecorder& recorder, int frames)
+{
+    // the path starts from the same pose every run
+    area.setRotate(QMatrix4x4());
+    area.rotateX(20);
+    recorder.render();
+
+    QVector<qint64> transform, cull, sort, draw, frame;
+    qint64 submitted = 0, culled = 0;
+    for (int f = 0; f < frames; f++) {
+        area.rotateY(360.0 / frames, true);
+        area.rotateX(7);
+        RenderStats stats = recorder.render();
+        transform.push_back(stats.transformNs);
+        cull.push_back(stats.cullNs);
+        sort.push_back(stats.sortNs);
+        draw.push_back(stats.drawNs);
+        frame.push_back(stats.frameNs);
+        submitted += stats.facesSubmitted;
+        culled += stats.facesCulledByNormal + stats.facesCulledByViewport;
+    }
+    return { { "facesSubmitted", double(submitted) / frames },
+             { "facesCulled", double(culled) / frames },
+             { "transform", timing(transform) }, { "cull", timing(cull) },
+             { "sort", timing(sort) }, { "draw", timing(draw) },
+             { "frame", timing(frame) } };
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication a(argc, argv);
+    const int largest = argc > 1 ? QString(argv[1]).toInt() : 10000000;
+    const int frames = argc > 2 ? QString(argv[2]).toInt() : 36;
+    const QSize size(1280, 720);
+    QTextStream progress(stderr);
+
+    QWidget window;
+    window.resize(size);
+    RenderArea area(&window);
+    QMatrix4x4 scale;
+    scale.scale(0.3f * size.height());
+    area.setScale(scale);
+    window.show();
+    FrameRecorder recorder(area);
+
+    const char* variants[] = { "none", "random", "default" };
+    QJsonArray runs;
+    for (int faces = 1000; faces <= largest; faces *= 10) {
+        Polyhedron mesh = torus(faces);
+        QElapsedTimer timer;
+        timer.start();
+        // the levels of detail are built on their own thread
+        QEventLoop building;
+        QObject::connect(&area, &RenderArea::levelsReady, &building, &QEventLoop::quit);
+        area.setFigure(mesh);
+        building.exec();
+        const double setupMs = timer.nsecsElapsed() / 1e6;
+        progress << mesh.polygonCount() << " faces, set up in " << setupMs << " ms" << '\n';
+        progress.flush();
+        for (int levels = 0; levels < 2; levels++)
+            for (int normals = 0; normals < 2; normals++)
+                for (int sorting = 0; sorting < 2; sorting++)
+                    for (int variant = RenderArea::NONE; variant <= RenderArea::DEFAULT; variant++)
+                        for (int wireframe = 0; wireframe < 2; wireframe++) {
+                            area.setIsUsingLevelsOfDetail(levels);
+                            area.setIsNormalMethodEnabled(normals);
+                            area.setIsZSortingEnabled(sorting);
+                            area.setFaceVariant(RenderArea::FaceVariant(variant));
+                            area.setIsDrawWireframe(wireframe);
+                            QJsonObject result = run(area, recorder, frames);
+                            result.insert("faces", qRound(result.value("facesSubmitted").toDouble()));
+                            result.insert("sourceFaces", mesh.polygonCount());
+                            result.insert("isUsingLevelsOfDetail", bool(levels));
+                            result.insert("setupMs", setupMs);
+                            result.insert("isNormalMethodEnabled", bool(normals));
+                            result.insert("isZSortingEnabled", bool(sorting));
+                            result.insert("faceVariant", variants[variant]);
+                            result.insert("isDrawingWireframe", bool(wireframe));
+                            runs.push_back(result);
+                            progress << "  " << result.value("frame").toObject()
+                                                      .value("mean").toDouble()
+                                     << " ms per frame" << '\n';
+                            progress.flush();
+                        }
+    }
+
+    QJsonObject report = {
+        { "width", size.width() }, { "height", size.height() },
+        { "frames", frames }, { "threads", threadCount() }, { "runs", runs },
+    };
+    QFile out;
+    out.open(stdout, QIODevice::WriteOnly);
+    out.write(QJsonDocument(report).toJson());
+    return 0;
+}